@@ -0,0 +1,149 @@
+#ifndef REFLECTION_GEN_PLUGIN_H
+#define REFLECTION_GEN_PLUGIN_H
+
+// The C ABI of the native generators. A plugin is a shared library passed with --plugin, which exports
+// ReflectionGenGetPlugin(). It's called on the work threads like the Lua callbacks, and can be used along with them.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RG_PLUGIN_API_VERSION 1
+
+// The host defines it to keep the text of the declarations for LuaJIT's ffi.cdef
+#ifndef RG_DECLARE_TYPES
+#define RG_DECLARE_TYPES(...) __VA_ARGS__
+#endif
+
+#if defined(_WIN32)
+#define RG_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define RG_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Plain C view of the metadata of a file. Strings are not null terminated, and are only valid during the call they're
+// got in. All the indices are 0 based, the members of a class/enum are contiguous. Annotations are the items as
+// written, e.g. `Category = "Physics"`.
+RG_DECLARE_TYPES(
+    typedef struct RgString {
+        const char* data;
+        size_t size;
+    } RgString;
+
+    typedef struct RgField {
+        RgString name;
+        RgString type;
+        uint32_t owner;
+        uint32_t firstAnnotation;
+        uint32_t annotationCount;
+        uint8_t isStatic;
+    } RgField;
+
+    typedef struct RgArgument {
+        RgString name;
+        RgString type;
+        uint32_t owner;
+    } RgArgument;
+
+    typedef struct RgMethod {
+        RgString name;
+        RgString type;
+        RgString returnType;
+        uint32_t owner;
+        uint32_t firstArgument;
+        uint32_t argumentCount;
+        uint32_t firstAnnotation;
+        uint32_t annotationCount;
+        uint8_t flags;
+    } RgMethod;
+
+    typedef struct RgEnumValue {
+        RgString name;
+        RgString value;
+        uint32_t owner;
+    } RgEnumValue;
+
+    typedef struct RgClass {
+        RgString name;
+        RgString fullName;
+        uint32_t firstField;
+        uint32_t fieldCount;
+        uint32_t firstMethod;
+        uint32_t methodCount;
+        uint32_t firstAnnotation;
+        uint32_t annotationCount;
+        uint8_t isAbstract;
+    } RgClass;
+
+    typedef struct RgEnum {
+        RgString name;
+        RgString fullName;
+        RgString underlyingType;
+        uint32_t firstValue;
+        uint32_t valueCount;
+        uint32_t firstAnnotation;
+        uint32_t annotationCount;
+        uint8_t isClass;
+    } RgEnum;
+
+    typedef struct RgTables {
+        const RgClass* classes;
+        const RgEnum* enums;
+        const RgField* fields;
+        const RgMethod* methods;
+        const RgArgument* arguments;
+        const RgEnumValue* enumValues;
+        const RgString* annotations;
+        uint32_t classCount;
+        uint32_t enumCount;
+        uint32_t fieldCount;
+        uint32_t methodCount;
+        uint32_t argumentCount;
+        uint32_t enumValueCount;
+        uint32_t annotationCount;
+    } RgTables;)
+
+// RgMethod::flags
+#define RG_METHOD_STATIC 1U
+#define RG_METHOD_CONSTRUCTOR 2U
+
+// The file being generated, like the task of OnFileParsed
+typedef struct RgTask {
+    RgString inputFile;
+    RgString outputFile;
+    // The parameters after '--', the first one is the script
+    const char* const* scriptParams;
+    uint32_t scriptParamCount;
+} RgTask;
+
+// The services of the host, the same as the FileUtils of the scripts, they return 0 on success
+typedef struct RgHost {
+    uint32_t apiVersion;
+    int (*MakeDirsForFile)(const char* filePath);
+    int (*WriteFile)(const char* filePath, const char* data, size_t size);
+} RgHost;
+
+// Any function can be NULL. Each work thread has a context of its own, so the calls with the same context never run
+// concurrently. The functions return 0 on success, a file whose callback fails is regenerated on the next run.
+typedef struct RgPlugin {
+    uint32_t apiVersion;
+    // Called once by each work thread before any file, *context is passed to the other functions
+    int (*CreateContext)(const RgHost* host, void** context);
+    void (*DestroyContext)(void* context);
+    int (*OnFileParsed)(void* context, const RgTables* tables, const RgTask* task);
+    // Called once after all the files, with all their classes and enums sorted by full name
+    int (*OnAllFilesParsed)(void* context, const RgTables* tables);
+} RgPlugin;
+
+// The function a plugin exports, it returns NULL if it doesn't support the API version of the host
+typedef const RgPlugin* (*RgGetPluginFunction)(uint32_t hostApiVersion);
+#define RG_GET_PLUGIN_FUNCTION_NAME "ReflectionGenGetPlugin"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
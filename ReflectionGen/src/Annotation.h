@@ -0,0 +1,236 @@
+#pragma once
+
+#include "InternedString.h"
+#include "StringUtils.h"
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The typed value of an annotation item, e.g. `Min = 3`, `Category = "hello"`, `Tags = (A, "b c", [1, 2])`,
+// a flag without value like `Serializable` is a boolean true.
+struct AnnotationValue {
+    enum class Type : uint8_t {
+        kBool,
+        kInteger,
+        kNumber,
+        kString,
+        kList,
+    };
+
+    Type type { Type::kBool };
+    bool boolean { true };
+    int64_t integer {};
+    double number {};
+    InternedString string {};
+    std::vector<AnnotationValue> list {};
+};
+
+// The keys are hashed by content, so that a key can be looked up as a string_view without interning it, e.g. when
+// a script reads a key which no annotation has
+struct AnnotationKeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view> {}(key); }
+};
+
+struct AnnotationKeyEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+};
+
+using AnnotationMap = std::unordered_map<InternedString, AnnotationValue, AnnotationKeyHash, AnnotationKeyEqual>;
+
+// The annotation grammar:
+//   annotations := item (',' item)*
+//   item        := key | key '=' value
+//   value       := string | number | 'true' | 'false' | list | bare text
+//   list        := ('(' | '[' | '{') value (',' value)* (')' | ']' | '}')
+//   string      := '"' chars with \" \\ \n \t escapes '"'
+// Commas and '=' inside strings and lists don't split, an unparsable item is kept as a flag named after its text.
+class AnnotationParser {
+public:
+    AnnotationParser() = delete;
+
+    // Split on the top level commas, each part trimmed, empty parts skipped. Returns false if a string isn't terminated,
+    // the items are still all split then, the last one holding the unterminated string.
+    static bool SplitItems(std::string_view text, std::vector<std::string_view>& items)
+    {
+        items.clear();
+        int depth = 0;
+        bool inString = false;
+        size_t start = 0;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            if (i < text.size()) {
+                char c = text[i];
+                if (inString) {
+                    if (c == '\\' && i + 1 < text.size()) {
+                        ++i;
+                    } else if (c == '"') {
+                        inString = false;
+                    }
+                    continue;
+                }
+                if (c == '"') {
+                    inString = true;
+                    continue;
+                }
+                if (c == '(' || c == '[' || c == '{') {
+                    ++depth;
+                    continue;
+                }
+                if ((c == ')' || c == ']' || c == '}') && depth > 0) {
+                    --depth;
+                    continue;
+                }
+                if (c != ',' || depth > 0) {
+                    continue;
+                }
+            }
+            auto item = StringUtils::Trimmed(text.substr(start, std::min(i, text.size()) - start));
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            start = i + 1;
+        }
+        return !inString;
+    }
+
+    static std::pair<InternedString, AnnotationValue> ParseItem(std::string_view item)
+    {
+        auto index = FindTopLevel(item, '=');
+        if (index == std::string_view::npos) {
+            return { InternedString { StringUtils::Trimmed(item) }, AnnotationValue {} };
+        }
+        auto key = StringUtils::Trimmed(item.substr(0, index));
+        if (key.empty()) {
+            return { InternedString { StringUtils::Trimmed(item) }, AnnotationValue {} };
+        }
+        return { InternedString { key }, ParseValue(StringUtils::Trimmed(item.substr(index + 1))) };
+    }
+
+    static AnnotationValue ParseValue(std::string_view text)
+    {
+        AnnotationValue value {};
+        if (text.size() >= 2 && text.front() == '"' && text.back() == '"') {
+            value.type = AnnotationValue::Type::kString;
+            value.string = Unescape(text.substr(1, text.size() - 2));
+            return value;
+        }
+        std::vector<std::string_view> elements;
+        if (text.size() >= 2 && IsMatchingBracket(text.front(), text.back()) && SplitItems(text.substr(1, text.size() - 2), elements)) {
+            value.type = AnnotationValue::Type::kList;
+            for (auto element : elements) {
+                value.list.push_back(ParseValue(element));
+            }
+            return value;
+        }
+        if (text == "true" || text == "false") {
+            value.boolean = text == "true";
+            return value;
+        }
+        auto* end = text.data() + text.size();
+        auto* begin = text.data() + (!text.empty() && text.front() == '+' ? 1 : 0);
+        if (auto [p, ec] = std::from_chars(begin, end, value.integer); ec == std::errc {} && p == end) {
+            value.type = AnnotationValue::Type::kInteger;
+            return value;
+        }
+        if (ParseNumber(std::string_view(begin, end - begin), value.number)) {
+            value.type = AnnotationValue::Type::kNumber;
+            return value;
+        }
+        value.type = AnnotationValue::Type::kString;
+        value.string = text;
+        return value;
+    }
+
+    // The first item with a given key wins
+    template <typename Annotations>
+    static void BuildMap(const Annotations& annotations, AnnotationMap& map)
+    {
+        map.clear();
+        for (auto& annotation : annotations) {
+            map.insert(ParseItem(annotation.str()));
+        }
+    }
+
+private:
+    // std::from_chars for double is missing from older standard libraries, the stream is pinned to the classic locale so
+    // that the decimal separator is always '.'
+    static bool ParseNumber(std::string_view text, double& number)
+    {
+        if (text.empty() || !(std::isdigit(static_cast<unsigned char>(text.front())) || text.front() == '-' || text.front() == '.')) {
+            return false;
+        }
+        std::istringstream stream { std::string(text) };
+        stream.imbue(std::locale::classic());
+        double parsed {};
+        stream >> parsed;
+        if (stream.fail() || stream.peek() != std::istringstream::traits_type::eof()) {
+            return false;
+        }
+        number = parsed;
+        return true;
+    }
+
+    static bool IsMatchingBracket(char open, char close)
+    {
+        return (open == '(' && close == ')') || (open == '[' && close == ']') || (open == '{' && close == '}');
+    }
+
+    static size_t FindTopLevel(std::string_view text, char target)
+    {
+        int depth = 0;
+        bool inString = false;
+        for (size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if (inString) {
+                if (c == '\\') {
+                    ++i;
+                } else if (c == '"') {
+                    inString = false;
+                }
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '(' || c == '[' || c == '{') {
+                ++depth;
+            } else if (c == ')' || c == ']' || c == '}') {
+                --depth;
+            } else if (c == target && depth == 0) {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    static InternedString Unescape(std::string_view text)
+    {
+        if (text.find('\\') == std::string_view::npos) {
+            return InternedString { text };
+        }
+        std::string s;
+        s.reserve(text.size());
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '\\' || i + 1 == text.size()) {
+                s.push_back(text[i]);
+                continue;
+            }
+            switch (text[++i]) {
+            case 'n':
+                s.push_back('\n');
+                break;
+            case 't':
+                s.push_back('\t');
+                break;
+            default:
+                s.push_back(text[i]);
+                break;
+            }
+        }
+        return InternedString { s };
+    }
+};
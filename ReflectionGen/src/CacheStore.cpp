@@ -0,0 +1,142 @@
+#include "CacheStore.h"
+#include "Hash.h"
+#include "StringUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static const char* const kTempFileMarker = ".tmp-";
+
+std::string CacheStore::GetEntryPath(std::string_view bucket, uint64_t key) const
+{
+    auto hex = HashToHex(key);
+    auto path = std::filesystem::path(dir_) / bucket / hex.substr(0, 2) / hex;
+    return path.string();
+}
+
+bool CacheStore::WriteFileAtomically(const std::string& path, std::string_view data)
+{
+    static std::atomic_uint64_t counter { 0 };
+    std::stringstream tmpPath;
+    tmpPath << path << kTempFileMarker << getpid() << '-' << std::this_thread::get_id() << '-' << counter++;
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    {
+        std::ofstream ofs(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        if (!ofs || !ofs.write(data.data(), std::streamsize(data.size())) || !ofs.flush()) {
+            std::cerr << "Failed to write " << tmpPath.str() << std::endl;
+            ofs.close();
+            std::filesystem::remove(tmpPath.str(), ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpPath.str(), path, ec);
+    if (ec) {
+        std::cerr << "Failed to rename " << tmpPath.str() << " to " << path << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tmpPath.str(), ec);
+        return false;
+    }
+    return true;
+}
+
+bool CacheStore::Get(std::string_view bucket, uint64_t key, std::string& data)
+{
+    auto path = GetEntryPath(bucket, key);
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        ++stats_.misses;
+        return false;
+    }
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    data = std::move(ss).str();
+
+    // Mark it as recently used, failure is not a problem
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    ++stats_.hits;
+    return true;
+}
+
+bool CacheStore::Put(std::string_view bucket, uint64_t key, std::string_view data)
+{
+    if (!WriteFileAtomically(GetEntryPath(bucket, key), data)) {
+        return false;
+    }
+    ++stats_.stores;
+    return true;
+}
+
+void CacheStore::Evict()
+{
+    if (maxSize_ == 0) {
+        return;
+    }
+
+    struct Entry {
+        std::filesystem::path path;
+        uint64_t size;
+        std::filesystem::file_time_type lastUsed;
+    };
+    std::vector<Entry> entries;
+    uint64_t totalSize = 0;
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(dir_, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        // Each call gets its own error code, the entry may be removed by another process meanwhile and is then skipped
+        std::error_code typeEc;
+        if (!it->is_regular_file(typeEc)) {
+            continue;
+        }
+        std::error_code sizeEc;
+        auto size = it->file_size(sizeEc);
+        std::error_code timeEc;
+        auto lastUsed = it->last_write_time(timeEc);
+        if (sizeEc || timeEc) {
+            continue;
+        }
+        Entry entry { it->path(), size, lastUsed };
+        if (StringUtils::Contains(entry.path.filename().string(), kTempFileMarker)) {
+            // Left by a crashed writer
+            if (now - entry.lastUsed > std::chrono::hours(1)) {
+                std::error_code removeEc;
+                std::filesystem::remove(entry.path, removeEc);
+            }
+            continue;
+        }
+        totalSize += entry.size;
+        entries.push_back(std::move(entry));
+    }
+    if (totalSize <= maxSize_) {
+        return;
+    }
+
+    // Shrink a bit more than needed, so that we don't evict on every run
+    auto targetSize = maxSize_ / 10 * 9;
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    for (auto& entry : entries) {
+        if (totalSize <= targetSize) {
+            break;
+        }
+        std::error_code removeEc;
+        if (std::filesystem::remove(entry.path, removeEc)) {
+            ++stats_.evictedEntries;
+            stats_.evictedBytes += entry.size;
+        }
+        totalSize -= entry.size;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A content-addressed blob store on disk, which can be shared by concurrent processes.
+// Entries are published by writing a temporary file then renaming it, so readers never see a partial entry,
+// and no lock is needed. Every hit refreshes the entry's mtime, which is used to evict the least recently used
+// entries once the store grows beyond its size limit.
+class CacheStore {
+public:
+    struct Stats {
+        std::atomic_uint64_t hits { 0 };
+        std::atomic_uint64_t misses { 0 };
+        std::atomic_uint64_t stores { 0 };
+        std::atomic_uint64_t evictedEntries { 0 };
+        std::atomic_uint64_t evictedBytes { 0 };
+    };
+
+    // maxSize == 0 means unlimited
+    CacheStore(std::string dir, uint64_t maxSize)
+        : dir_ { std::move(dir) }
+        , maxSize_ { maxSize }
+    {
+    }
+
+    bool Get(std::string_view bucket, uint64_t key, std::string& data);
+
+    bool Put(std::string_view bucket, uint64_t key, std::string_view data);
+
+    void Evict();
+
+    const Stats& GetStats() const { return stats_; }
+
+    // Write to a unique temporary file beside path, then rename it to path
+    static bool WriteFileAtomically(const std::string& path, std::string_view data);
+
+private:
+    std::string GetEntryPath(std::string_view bucket, uint64_t key) const;
+
+private:
+    std::string dir_;
+    uint64_t maxSize_;
+    Stats stats_ {};
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Meta.h"
+#include "MetaTables.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Declares the C structs of the plugin ABI and keeps their text in kFfiCdef, so that what LuaJIT's ffi.cdef sees
+// can't differ from what the compiler lays out
+#define RG_DECLARE_TYPES(...) \
+    __VA_ARGS__               \
+    static constexpr const char* kFfiCdef = #__VA_ARGS__;
+#include "ReflectionGenPlugin.h"
+
+// The RgTables of a file, for scripts run by LuaJIT, which read it in place through FFI cdata instead of usertypes,
+// and for the native plugins. Strings point to the interned strings and the arena of the ParseState, so the view is
+// only valid as long as the ParseState.
+// Owns the arrays RgTables points to, built from the columnar tables
+class FfiTables {
+public:
+    void Build(const MetaTables& tables)
+    {
+        auto& classList = *tables.classes;
+        auto& enumList = *tables.enums;
+        classes_.reserve(classList.size());
+        for (auto* classMeta : classList) {
+            classes_.push_back(RgClass { ToRg(classMeta->name), ToRg(classMeta->GetFullName()), 0, 0, 0, 0, 0, 0, classMeta->isAbstract });
+        }
+        enums_.reserve(enumList.size());
+        for (auto* enumMeta : enumList) {
+            enums_.push_back(RgEnum { ToRg(enumMeta->name), ToRg(enumMeta->GetFullName()), ToRg(enumMeta->underlyingType), 0, 0, 0, 0, enumMeta->isClass });
+        }
+
+        fields_.reserve(tables.fields.Size());
+        for (uint32_t i = 0; i < tables.fields.Size(); ++i) {
+            auto owner = tables.fields.owner[i];
+            fields_.push_back(RgField { ToRg(tables.fields.name[i]), ToRg(tables.fields.type[i]), owner, 0, 0, tables.fields.isStatic[i] });
+            AddMember(classes_[owner].firstField, classes_[owner].fieldCount, i);
+        }
+        methods_.reserve(tables.methods.Size());
+        for (uint32_t i = 0; i < tables.methods.Size(); ++i) {
+            auto owner = tables.methods.owner[i];
+            methods_.push_back(RgMethod { ToRg(tables.methods.name[i]), ToRg(tables.methods.type[i]), ToRg(tables.methods.returnType[i]),
+                owner, tables.methods.firstArgument[i], tables.methods.argumentCount[i], 0, 0, tables.methods.flags[i] });
+            AddMember(classes_[owner].firstMethod, classes_[owner].methodCount, i);
+        }
+        arguments_.reserve(tables.arguments.Size());
+        for (uint32_t i = 0; i < tables.arguments.Size(); ++i) {
+            arguments_.push_back(RgArgument { ToRg(tables.arguments.name[i]), ToRg(tables.arguments.type[i]), tables.arguments.owner[i] });
+        }
+        enumValues_.reserve(tables.enumValues.Size());
+        for (uint32_t i = 0; i < tables.enumValues.Size(); ++i) {
+            auto owner = tables.enumValues.owner[i];
+            enumValues_.push_back(RgEnumValue { ToRg(tables.enumValues.name[i]), ToRg(tables.enumValues.value[i]), owner });
+            AddMember(enums_[owner].firstValue, enums_[owner].valueCount, i);
+        }
+        // In the order of MetaTables: the classes, each with its fields then its constructors and methods
+        uint32_t field = 0;
+        uint32_t method = 0;
+        for (uint32_t i = 0; i < classList.size(); ++i) {
+            auto* classMeta = classList[i];
+            AddAnnotations(*classMeta, classes_[i].firstAnnotation, classes_[i].annotationCount);
+            for (auto* fieldMeta : classMeta->fields) {
+                AddAnnotations(*fieldMeta, fields_[field].firstAnnotation, fields_[field].annotationCount);
+                ++field;
+            }
+            for (auto* ctor : classMeta->constructors) {
+                AddAnnotations(*ctor, methods_[method].firstAnnotation, methods_[method].annotationCount);
+                ++method;
+            }
+            for (auto* methodMeta : classMeta->methods) {
+                AddAnnotations(*methodMeta, methods_[method].firstAnnotation, methods_[method].annotationCount);
+                ++method;
+            }
+        }
+        for (uint32_t i = 0; i < enumList.size(); ++i) {
+            AddAnnotations(*enumList[i], enums_[i].firstAnnotation, enums_[i].annotationCount);
+        }
+
+        root_ = RgTables {
+            classes_.data(), enums_.data(), fields_.data(), methods_.data(), arguments_.data(), enumValues_.data(),
+            annotations_.data(), uint32_t(classes_.size()), uint32_t(enums_.size()), uint32_t(fields_.size()),
+            uint32_t(methods_.size()), uint32_t(arguments_.size()), uint32_t(enumValues_.size()), uint32_t(annotations_.size())
+        };
+    }
+
+    const RgTables* Get() const { return &root_; }
+
+private:
+    static RgString ToRg(std::string_view s) { return RgString { s.data(), s.size() }; }
+
+    // MetaTables adds the members class by class, so recording the first and counting is enough
+    static void AddMember(uint32_t& first, uint32_t& count, uint32_t index)
+    {
+        if (count == 0) {
+            first = index;
+        }
+        ++count;
+    }
+
+    void AddAnnotations(const BaseMeta& meta, uint32_t& first, uint32_t& count)
+    {
+        first = uint32_t(annotations_.size());
+        count = uint32_t(meta.annotations.size());
+        for (auto& annotation : meta.annotations) {
+            annotations_.push_back(ToRg(annotation));
+        }
+    }
+
+private:
+    std::vector<RgClass> classes_ {};
+    std::vector<RgEnum> enums_ {};
+    std::vector<RgField> fields_ {};
+    std::vector<RgMethod> methods_ {};
+    std::vector<RgArgument> arguments_ {};
+    std::vector<RgEnumValue> enumValues_ {};
+    std::vector<RgString> annotations_ {};
+    RgTables root_ {};
+};
@@ -0,0 +1,64 @@
+#include "FileUtils.h"
+#include "CacheStore.h"
+#include "OutputWriter.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static std::atomic<OutputWriter*> gOutputWriter { nullptr };
+static thread_local std::vector<std::string>* tWrittenFiles { nullptr };
+
+bool FileUtils::MakeDirsForFile(const std::string& filePath)
+{
+    std::filesystem::path p(filePath);
+    p = p.parent_path();
+    std::error_code ec;
+    std::filesystem::create_directories(p, ec);
+    return !ec;
+}
+
+bool FileUtils::WriteFile(const std::string& filePath, std::string_view data)
+{
+    if (tWrittenFiles != nullptr) {
+        tWrittenFiles->push_back(filePath);
+    }
+    if (auto* writer = gOutputWriter.load()) {
+        writer->Write(filePath, std::string(data));
+        return true;
+    }
+    bool unchanged = false;
+    return WriteFileIfChanged(filePath, data, unchanged);
+}
+
+// Whether the file already holds exactly data, the size is checked first so that most changed files aren't read
+static bool HasContent(const std::string& filePath, std::string_view data)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(filePath, ec);
+    if (ec || size != data.size()) {
+        return false;
+    }
+    std::ifstream ifs(filePath, std::ios::binary);
+    std::string content(data.size(), '\0');
+    if (!ifs.read(content.data(), std::streamsize(content.size()))) {
+        return false;
+    }
+    return content == data;
+}
+
+bool FileUtils::WriteFileIfChanged(const std::string& filePath, std::string_view data, bool& unchanged)
+{
+    unchanged = HasContent(filePath, data);
+    // Creates the directories too, and reports the errors
+    return unchanged || CacheStore::WriteFileAtomically(filePath, data);
+}
+
+void FileUtils::SetOutputWriter(OutputWriter* writer)
+{
+    gOutputWriter = writer;
+}
+
+void FileUtils::RecordWrittenFiles(std::vector<std::string>* files)
+{
+    tWrittenFiles = files;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+class OutputWriter;
+
+// The file services of the scripts and the native plugins
+class FileUtils {
+public:
+    // Creates the directories the file will be in
+    static bool MakeDirsForFile(const std::string& filePath);
+    // See WriteFileIfChanged(). With an output writer, the file is only queued, and its errors are reported by
+    // OutputWriter::Finish()
+    static bool WriteFile(const std::string& filePath, std::string_view data);
+    // Leaves the file untouched if it already holds data, which keeps its mtime for the build system, otherwise creates
+    // its directories and writes a temporary file renamed to it. Reports the error to std::cerr
+    static bool WriteFileIfChanged(const std::string& filePath, std::string_view data, bool& unchanged);
+
+    // nullptr to write the files synchronously again
+    static void SetOutputWriter(OutputWriter* writer);
+
+    // The paths given to WriteFile() by the calling thread are appended to files, nullptr to stop recording
+    static void RecordWrittenFiles(std::vector<std::string>* files);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 64 bits FNV-1a, stable across runs, platforms and standard library versions,
+// which std::hash does not guarantee.
+class Hasher {
+public:
+    static constexpr uint64_t kOffsetBasis = 0xcbf29ce484222325ULL;
+    static constexpr uint64_t kPrime = 0x00000100000001b3ULL;
+
+    explicit Hasher(uint64_t seed = kOffsetBasis)
+        : hash_ { seed }
+    {
+    }
+
+    Hasher& Update(const void* data, size_t size)
+    {
+        auto* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash_ ^= p[i];
+            hash_ *= kPrime;
+        }
+        return *this;
+    }
+
+    Hasher& Update(std::string_view s)
+    {
+        // Hash the length too, so that ("ab", "c") and ("a", "bc") differ
+        Update(uint64_t(s.size()));
+        return Update(s.data(), s.size());
+    }
+
+    Hasher& Update(uint64_t v)
+    {
+        return Update(&v, sizeof(v));
+    }
+
+    uint64_t Digest() const { return hash_; }
+
+private:
+    uint64_t hash_;
+};
+
+inline uint64_t HashString(std::string_view s)
+{
+    return Hasher {}.Update(s.data(), s.size()).Digest();
+}
+
+inline std::string HashToHex(uint64_t hash)
+{
+    static const char kDigits[] = "0123456789abcdef";
+    std::string s(16, '0');
+    for (int i = 15; i >= 0; --i) {
+        s[i] = kDigits[hash & 0xFU];
+        hash >>= 4U;
+    }
+    return s;
+}
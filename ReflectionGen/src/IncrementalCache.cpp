@@ -0,0 +1,387 @@
+#include "IncrementalCache.h"
+#include "Hash.h"
+#include "ParseStateSerializer.h"
+#include "StringUtils.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+static const char* const kManifestHeader = "ReflectionGenManifest 4";
+static const char* const kDependenciesHeader = "ReflectionGenDeps 2";
+static const char* const kDependenciesBucket = "deps";
+static const char* const kParseResultBucket = "parse";
+
+FileStat FileStat::Of(const std::string& path)
+{
+    FileStat fs {};
+#ifdef _WIN32
+    struct _stat64 st {};
+    if (0 != _stat64(path.c_str(), &st)) {
+        return fs;
+    }
+    fs.mtimeNs = int64_t(st.st_mtime) * 1000000000LL;
+#else
+    struct stat st {};
+    if (0 != stat(path.c_str(), &st)) {
+        return fs;
+    }
+#ifdef __APPLE__
+    fs.mtimeNs = int64_t(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    fs.mtimeNs = int64_t(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+#endif
+    fs.exists = true;
+    fs.inode = uint64_t(st.st_ino);
+    fs.size = uint64_t(st.st_size);
+    return fs;
+}
+
+IncrementalCache::IncrementalCache(std::string cacheDir, std::string targetId, uint64_t maxSize)
+    : cacheDir_ { std::move(cacheDir) }
+    , targetId_ { std::move(targetId) }
+    , store_ { (std::filesystem::path(cacheDir_) / "objects").string(), maxSize }
+{
+}
+
+std::string IncrementalCache::NormalizePath(const std::string& path)
+{
+    std::error_code ec;
+    auto p = std::filesystem::absolute(path, ec);
+    if (ec) {
+        return path;
+    }
+    return p.lexically_normal().string();
+}
+
+std::string IncrementalCache::NormalizeDependencyPath(const std::string& path)
+{
+    // libclang reports e.g. '/usr/lib/gcc/x86_64-linux-gnu/12/../../../../include/c++/12/string', where '..' may go
+    // through a symbolic link, so it can't be removed lexically. Only the existing part of the path is resolved
+    std::error_code ec;
+    auto p = std::filesystem::weakly_canonical(path, ec);
+    if (ec) {
+        return path;
+    }
+    return p.string();
+}
+
+bool IncrementalCache::HashFileContent(const std::string& path, uint64_t& hash)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+    Hasher hasher {};
+    char buffer[64 * 1024];
+    while (ifs) {
+        ifs.read(buffer, sizeof(buffer));
+        hasher.Update(buffer, size_t(ifs.gcount()));
+    }
+    hash = hasher.Digest();
+    return true;
+}
+
+std::string IncrementalCache::GetManifestPath() const
+{
+    return (std::filesystem::path(cacheDir_) / "manifests" / targetId_).string();
+}
+
+bool IncrementalCache::Load()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(cacheDir_) / "manifests", ec);
+    if (ec) {
+        std::cerr << "Failed to create cache directory " << cacheDir_ << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    std::ifstream ifs(GetManifestPath());
+    if (!ifs) {
+        return true; // first run
+    }
+    std::string line;
+    if (!std::getline(ifs, line) || line != kManifestHeader) {
+        std::cerr << "Ignoring incompatible cache manifest " << GetManifestPath() << std::endl;
+        return true;
+    }
+
+    auto fail = [this]() {
+        std::cerr << "Ignoring corrupted cache manifest " << GetManifestPath() << std::endl;
+        records_.clear();
+        return true;
+    };
+    std::vector<std::string_view> parts;
+    while (std::getline(ifs, line)) {
+        parts.clear();
+        StringUtils::Split(parts, line, '\t');
+        if (parts.size() != 6 || parts[0] != "I") {
+            return fail();
+        }
+        Record record {};
+        record.envHash = std::strtoull(std::string(parts[1]).c_str(), nullptr, 16);
+        record.resultKey = std::strtoull(std::string(parts[2]).c_str(), nullptr, 16);
+        auto count = std::strtoull(std::string(parts[3]).c_str(), nullptr, 10);
+        auto outputCount = std::strtoull(std::string(parts[4]).c_str(), nullptr, 10);
+        std::string inputFile { parts[5] };
+        for (size_t i = 0; i < count; ++i) {
+            if (!std::getline(ifs, line)) {
+                return fail();
+            }
+            parts.clear();
+            StringUtils::Split(parts, line, '\t');
+            if (parts.size() != 3 || parts[0] != "H") {
+                return fail();
+            }
+            record.entityHashes[std::string(parts[2])] = std::strtoull(std::string(parts[1]).c_str(), nullptr, 16);
+        }
+        for (size_t i = 0; i < outputCount; ++i) {
+            if (!std::getline(ifs, line) || line.size() < 2 || line.compare(0, 2, "O\t") != 0) {
+                return fail();
+            }
+            record.outputs.push_back(line.substr(2));
+        }
+        records_[std::move(inputFile)] = std::move(record);
+    }
+    return true;
+}
+
+bool IncrementalCache::Save()
+{
+    store_.Evict();
+
+    std::unique_lock<std::mutex> lck(recordsMutex_);
+    if (!dirty_) {
+        return true;
+    }
+    std::stringstream ss;
+    ss << kManifestHeader << '\n';
+    for (auto& [inputFile, record] : records_) {
+        ss << "I\t" << HashToHex(record.envHash) << '\t' << HashToHex(record.resultKey) << '\t'
+           << record.entityHashes.size() << '\t' << record.outputs.size() << '\t' << inputFile << '\n';
+        for (auto& [fullName, hash] : record.entityHashes) {
+            ss << "H\t" << HashToHex(hash) << '\t' << fullName << '\n';
+        }
+        for (auto& output : record.outputs) {
+            ss << "O\t" << output << '\n';
+        }
+    }
+    if (!CacheStore::WriteFileAtomically(GetManifestPath(), ss.str())) {
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+IncrementalCache::FileState IncrementalCache::GetFileState(const std::string& path, bool needHash)
+{
+    {
+        std::unique_lock<std::mutex> lck(filesMutex_);
+        auto it = files_.find(path);
+        if (it != files_.end() && (!needHash || it->second.hashed || it->second.hashFailed)) {
+            return it->second;
+        }
+    }
+
+    // Do the IO without lock, racing threads may stat/hash the same file twice, which is harmless
+    FileState state {};
+    state.stat = FileStat::Of(path);
+    ++stats_.filesStated;
+    if (needHash && state.stat.exists) {
+        state.hashed = HashFileContent(path, state.contentHash);
+        state.hashFailed = !state.hashed;
+        ++stats_.filesHashed;
+    }
+
+    std::unique_lock<std::mutex> lck(filesMutex_);
+    auto& slot = files_[path];
+    if (!slot.hashed) {
+        slot = state;
+    }
+    return slot;
+}
+
+uint64_t IncrementalCache::GetDependenciesKey(const std::string& normalInputFile, uint64_t parseEnvHash)
+{
+    return Hasher {}.Update(std::string_view(kDependenciesBucket)).Update(normalInputFile).Update(parseEnvHash).Digest();
+}
+
+uint64_t IncrementalCache::GetResultKey(uint64_t parseEnvHash, const std::vector<Dependency>& dependencies)
+{
+    Hasher hasher {};
+    hasher.Update(std::string_view(kParseResultBucket)).Update(uint64_t(ParseStateSerializer::kFormatVersion)).Update(parseEnvHash);
+    for (auto& dep : dependencies) {
+        hasher.Update(dep.path).Update(dep.contentHash);
+    }
+    return hasher.Digest();
+}
+
+bool IncrementalCache::PutDependencies(uint64_t depsKey, const std::vector<Dependency>& dependencies, bool withoutAnnotations)
+{
+    std::stringstream ss;
+    ss << kDependenciesHeader << '\n';
+    if (withoutAnnotations) {
+        ss << "E\n";
+    }
+    for (auto& dep : dependencies) {
+        ss << "D\t" << dep.stat.inode << '\t' << dep.stat.size << '\t' << dep.stat.mtimeNs << '\t'
+           << HashToHex(dep.contentHash) << '\t' << dep.path << '\n';
+    }
+    return store_.Put(kDependenciesBucket, depsKey, ss.str());
+}
+
+bool IncrementalCache::FindParseResult(const std::string& inputFile, uint64_t parseEnvHash, uint64_t& resultKey, bool& withoutAnnotations)
+{
+    withoutAnnotations = false;
+    auto depsKey = GetDependenciesKey(NormalizePath(inputFile), parseEnvHash);
+    std::string data;
+    if (!store_.Get(kDependenciesBucket, depsKey, data)) {
+        return false;
+    }
+
+    std::vector<Dependency> dependencies;
+    std::stringstream ss { std::move(data) };
+    std::string line;
+    if (!std::getline(ss, line) || line != kDependenciesHeader) {
+        return false;
+    }
+    std::vector<std::string_view> parts;
+    bool empty = false;
+    while (std::getline(ss, line)) {
+        if (line == "E") {
+            empty = true;
+            continue;
+        }
+        parts.clear();
+        StringUtils::Split(parts, line, '\t');
+        if (parts.size() != 6 || parts[0] != "D") {
+            return false;
+        }
+        Dependency dep {};
+        dep.stat.exists = true;
+        dep.stat.inode = std::strtoull(std::string(parts[1]).c_str(), nullptr, 10);
+        dep.stat.size = std::strtoull(std::string(parts[2]).c_str(), nullptr, 10);
+        dep.stat.mtimeNs = std::strtoll(std::string(parts[3]).c_str(), nullptr, 10);
+        dep.contentHash = std::strtoull(std::string(parts[4]).c_str(), nullptr, 16);
+        dep.path = parts[5];
+        dependencies.push_back(std::move(dep));
+    }
+
+    bool statsRefreshed = false;
+    for (auto& dep : dependencies) {
+        auto state = GetFileState(dep.path, false);
+        if (state.stat == dep.stat) {
+            continue;
+        }
+        // Touched, moved or copied, but may have the same content
+        state = GetFileState(dep.path, true);
+        if (!state.hashed || state.contentHash != dep.contentHash) {
+            return false;
+        }
+        dep.stat = state.stat;
+        statsRefreshed = true;
+    }
+    if (statsRefreshed) {
+        // Record the new stat, so that the next run can take the fast path again
+        PutDependencies(depsKey, dependencies, empty);
+    }
+    resultKey = GetResultKey(parseEnvHash, dependencies);
+    withoutAnnotations = empty;
+    if (empty) {
+        ++stats_.withoutAnnotations;
+    }
+    return true;
+}
+
+bool IncrementalCache::LoadParseResult(uint64_t resultKey, std::string& data)
+{
+    if (store_.Get(kParseResultBucket, resultKey, data)) {
+        ++stats_.parseHits;
+        return true;
+    }
+    ++stats_.parseMisses;
+    return false;
+}
+
+uint64_t IncrementalCache::StoreParseResult(const std::string& inputFile, uint64_t parseEnvHash, const std::vector<std::string>& dependencies,
+    std::string_view data, bool withoutAnnotations)
+{
+    std::vector<Dependency> deps;
+    deps.reserve(dependencies.size());
+    for (auto& path : dependencies) {
+        auto normalPath = NormalizeDependencyPath(path);
+        auto state = GetFileState(normalPath, true);
+        if (!state.hashed) {
+            // Can't track it, never treat the input as up to date
+            std::cerr << "Not caching the parse result of " << inputFile << ", failed to read its dependency " << path << std::endl;
+            return 0;
+        }
+        deps.push_back(Dependency { normalPath, state.stat, state.contentHash });
+    }
+
+    auto resultKey = GetResultKey(parseEnvHash, deps);
+    // Publish the result before the dependencies which refer to it
+    if (!store_.Put(kParseResultBucket, resultKey, data)
+        || !PutDependencies(GetDependenciesKey(NormalizePath(inputFile), parseEnvHash), deps, withoutAnnotations)) {
+        return 0;
+    }
+    return resultKey;
+}
+
+bool IncrementalCache::IsGenerated(const std::string& inputFile, uint64_t envHash, uint64_t resultKey)
+{
+    std::vector<std::string> outputs;
+    {
+        std::unique_lock<std::mutex> lck(recordsMutex_);
+        auto it = records_.find(NormalizePath(inputFile));
+        if (it == records_.end() || it->second.envHash != envHash || it->second.resultKey != resultKey) {
+            return false;
+        }
+        outputs = it->second.outputs;
+    }
+    // Like a build system, an output deleted since, e.g. by cleaning the output directory, is generated again
+    for (auto& output : outputs) {
+        ++stats_.filesStated;
+        if (!FileStat::Of(output).exists) {
+            return false;
+        }
+    }
+    ++stats_.upToDate;
+    return true;
+}
+
+void IncrementalCache::MarkGenerated(const std::string& inputFile, uint64_t envHash, uint64_t resultKey, std::unordered_map<std::string, uint64_t> entityHashes,
+    const std::vector<std::string>& outputs)
+{
+    Record record { envHash, resultKey, std::move(entityHashes), {} };
+    record.outputs.reserve(outputs.size());
+    for (auto& output : outputs) {
+        record.outputs.push_back(NormalizePath(output));
+    }
+    std::sort(record.outputs.begin(), record.outputs.end());
+    record.outputs.erase(std::unique(record.outputs.begin(), record.outputs.end()), record.outputs.end());
+    std::unique_lock<std::mutex> lck(recordsMutex_);
+    records_[NormalizePath(inputFile)] = std::move(record);
+    dirty_ = true;
+}
+
+std::unordered_map<std::string, uint64_t> IncrementalCache::GetPreviousStructuralHashes(const std::string& inputFile, uint64_t envHash)
+{
+    std::unique_lock<std::mutex> lck(recordsMutex_);
+    auto it = records_.find(NormalizePath(inputFile));
+    if (it == records_.end() || it->second.envHash != envHash) {
+        return {};
+    }
+    return it->second.entityHashes;
+}
+
+void IncrementalCache::Invalidate(const std::string& inputFile)
+{
+    std::unique_lock<std::mutex> lck(recordsMutex_);
+    if (records_.erase(NormalizePath(inputFile)) > 0) {
+        dirty_ = true;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "CacheStore.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct FileStat {
+    bool exists { false };
+    uint64_t inode {};
+    uint64_t size {};
+    int64_t mtimeNs {};
+
+    bool operator==(const FileStat& o) const
+    {
+        return exists == o.exists && inode == o.inode && size == o.size && mtimeNs == o.mtimeNs;
+    }
+    bool operator!=(const FileStat& o) const { return !(*this == o); }
+
+    static FileStat Of(const std::string& path);
+};
+
+// The cache directory can be shared by concurrent ReflectionGen invocations:
+//  - objects/deps: per input file (and compiler arguments), the files it was built from, i.e. the input itself and
+//    everything it includes. A file is considered unchanged if its (inode, size, mtime) tuple is the recorded one,
+//    only when the tuple differs we fall back to compare the content hash, so a no-op run only stats files. It also
+//    tells whether the parse result has no annotated entity, such files can be skipped without even loading it.
+//  - objects/parse: the serialized parse results, addressed by the content of all the files they were built from,
+//    so a header parsed by one invocation is a hit for all the others.
+//  - manifests/<target>: per target (script + output directory), which parse result the outputs were generated
+//    from and the files written for it, so that the inputs whose outputs are up to date and still exist can be
+//    skipped entirely, and the structural hash of each class/enum, so that the script can only regenerate the
+//    changed ones.
+class IncrementalCache {
+public:
+    struct Dependency {
+        std::string path;
+        FileStat stat;
+        uint64_t contentHash;
+    };
+
+    struct Stats {
+        std::atomic_uint64_t upToDate { 0 };
+        std::atomic_uint64_t parseHits { 0 };
+        std::atomic_uint64_t parseMisses { 0 };
+        std::atomic_uint64_t withoutAnnotations { 0 }; // parse results found without any annotated entity
+        std::atomic_uint64_t filesStated { 0 };
+        std::atomic_uint64_t filesHashed { 0 };
+    };
+
+    IncrementalCache(std::string cacheDir, std::string targetId, uint64_t maxSize);
+
+    bool Load();
+
+    // Save this target's manifest, and evict old entries if the store is too large
+    bool Save();
+
+    // parseEnvHash identifies everything except the input files which affects the parse result,
+    // i.e. compiler arguments. Return false if the input was never parsed or any of its dependencies changed.
+    // withoutAnnotations tells whether the parse result has no annotated entity at all (negative cache).
+    bool FindParseResult(const std::string& inputFile, uint64_t parseEnvHash, uint64_t& resultKey, bool& withoutAnnotations);
+
+    bool LoadParseResult(uint64_t resultKey, std::string& data);
+
+    // Return the result key, 0 if failed
+    uint64_t StoreParseResult(const std::string& inputFile, uint64_t parseEnvHash, const std::vector<std::string>& dependencies,
+        std::string_view data, bool withoutAnnotations);
+
+    // envHash identifies everything which affects the output but the parse result, i.e. the script and the output path.
+    // The files written for the input are stated, it isn't generated anymore if any of them is missing.
+    bool IsGenerated(const std::string& inputFile, uint64_t envHash, uint64_t resultKey);
+
+    // entityHashes: full name -> structural hash of the classes and enums the outputs were generated from,
+    // outputs: the files written for the input
+    void MarkGenerated(const std::string& inputFile, uint64_t envHash, uint64_t resultKey, std::unordered_map<std::string, uint64_t> entityHashes,
+        const std::vector<std::string>& outputs);
+
+    // The structural hashes recorded by MarkGenerated in the last run, empty if the script/output changed since then
+    std::unordered_map<std::string, uint64_t> GetPreviousStructuralHashes(const std::string& inputFile, uint64_t envHash);
+
+    void Invalidate(const std::string& inputFile);
+
+    const Stats& GetStats() const { return stats_; }
+
+    const CacheStore::Stats& GetStoreStats() const { return store_.GetStats(); }
+
+    // Lexical, for the paths given by the user, which are looked up on every run
+    static std::string NormalizePath(const std::string& path);
+
+    // Resolves the symbolic links, for the files reported by libclang, which are only normalized when stored
+    static std::string NormalizeDependencyPath(const std::string& path);
+
+    static bool HashFileContent(const std::string& path, uint64_t& hash);
+
+private:
+    struct Record {
+        uint64_t envHash {};
+        uint64_t resultKey {};
+        std::unordered_map<std::string, uint64_t> entityHashes {};
+        std::vector<std::string> outputs {}; // normalized
+    };
+
+    struct FileState {
+        FileStat stat {};
+        bool hashed { false };
+        bool hashFailed { false };
+        uint64_t contentHash {};
+    };
+
+    // Stat/hash each file at most once per run, headers are shared by lots of inputs
+    FileState GetFileState(const std::string& path, bool needHash);
+
+    static uint64_t GetDependenciesKey(const std::string& normalInputFile, uint64_t parseEnvHash);
+
+    static uint64_t GetResultKey(uint64_t parseEnvHash, const std::vector<Dependency>& dependencies);
+
+    bool PutDependencies(uint64_t depsKey, const std::vector<Dependency>& dependencies, bool withoutAnnotations);
+
+    std::string GetManifestPath() const;
+
+private:
+    std::string cacheDir_;
+    std::string targetId_;
+    CacheStore store_;
+
+    std::mutex recordsMutex_ {};
+    std::unordered_map<std::string, Record> records_ {};
+    bool dirty_ { false };
+
+    std::mutex filesMutex_ {};
+    std::unordered_map<std::string, FileState> files_ {};
+
+    Stats stats_ {};
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+// Process wide string table shared by all the work threads. Strings are never removed, so the returned pointers
+// stay valid until exit. It's split into shards by hash, each with its own lock, so that the workers rarely wait
+// for each other.
+class StringPool {
+public:
+    static StringPool& Global()
+    {
+        static StringPool pool {};
+        return pool;
+    }
+
+    static const std::string& Empty()
+    {
+        static const std::string empty {};
+        return empty;
+    }
+
+    const std::string* Intern(std::string_view s)
+    {
+        if (s.empty()) {
+            return &Empty();
+        }
+        auto hash = std::hash<std::string_view> {}(s);
+        auto& shard = shards_[(hash >> 7U) % kShardCount];
+        std::unique_lock<std::mutex> lck(shard.mutex);
+        auto it = shard.strings.find(s);
+        if (it == shard.strings.end()) {
+            it = shard.strings.emplace(s).first;
+        }
+        return &*it;
+    }
+
+private:
+    struct TransparentHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view> {}(s); }
+    };
+
+    struct Shard {
+        std::mutex mutex {};
+        // Node based, so the strings never move
+        std::unordered_set<std::string, TransparentHash, std::equal_to<>> strings {};
+    };
+
+    static constexpr size_t kShardCount = 64;
+
+    std::array<Shard, kShardCount> shards_ {};
+};
+
+// A handle to a string in the StringPool, equal strings share the same handle, so copying and comparing
+// are pointer operations.
+class InternedString {
+public:
+    InternedString()
+        : str_ { &StringPool::Empty() }
+    {
+    }
+    InternedString(std::string_view s) // NOLINT(google-explicit-constructor)
+        : str_ { StringPool::Global().Intern(s) }
+    {
+    }
+    InternedString(const std::string& s) // NOLINT(google-explicit-constructor)
+        : InternedString(std::string_view(s))
+    {
+    }
+    InternedString(const char* s) // NOLINT(google-explicit-constructor)
+        : InternedString(std::string_view(s))
+    {
+    }
+
+    const std::string& str() const { return *str_; }
+    const char* c_str() const { return str_->c_str(); }
+    size_t size() const { return str_->size(); }
+    bool empty() const { return str_->empty(); }
+
+    operator const std::string&() const { return *str_; } // NOLINT(google-explicit-constructor)
+    operator std::string_view() const { return *str_; }   // NOLINT(google-explicit-constructor)
+
+    bool operator==(const InternedString& o) const { return str_ == o.str_; }
+    bool operator!=(const InternedString& o) const { return str_ != o.str_; }
+    bool operator<(const InternedString& o) const { return *str_ < *o.str_; }
+
+private:
+    const std::string* str_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const InternedString& s)
+{
+    return os << s.str();
+}
+
+template <>
+struct std::hash<InternedString> {
+    size_t operator()(const InternedString& s) const { return std::hash<const void*> {}(&s.str()); }
+};
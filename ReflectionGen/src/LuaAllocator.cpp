@@ -0,0 +1,97 @@
+#include "LuaAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+LuaAllocator::~LuaAllocator()
+{
+    for (auto* chunk : chunks_) {
+        std::free(chunk);
+    }
+}
+
+void* LuaAllocator::Allocate(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    auto* self = static_cast<LuaAllocator*>(ud);
+    // osize is the size of the block only if there's one, otherwise it's the type of the new object
+    if (ptr == nullptr) {
+        osize = 0;
+    }
+    if (nsize == 0) {
+        self->Delete(ptr, osize);
+        return nullptr;
+    }
+    if (ptr != nullptr) {
+        bool bothPooled = osize <= kMaxPooledSize && nsize <= kMaxPooledSize;
+        if (bothPooled && ClassOf(osize) == ClassOf(nsize)) {
+            self->stats_.bytesInUse += nsize - osize;
+            self->stats_.peakBytesInUse = std::max(self->stats_.peakBytesInUse, self->stats_.bytesInUse);
+            return ptr;
+        }
+        if (osize > kMaxPooledSize && nsize > kMaxPooledSize) {
+            auto* p = std::realloc(ptr, nsize);
+            if (p != nullptr) {
+                self->stats_.bytesInUse += nsize - osize;
+                self->stats_.peakBytesInUse = std::max(self->stats_.peakBytesInUse, self->stats_.bytesInUse);
+            }
+            return p;
+        }
+    }
+    auto* p = self->New(nsize);
+    if (p != nullptr && ptr != nullptr) {
+        std::memcpy(p, ptr, std::min(osize, nsize));
+        self->Delete(ptr, osize);
+    }
+    return p;
+}
+
+void* LuaAllocator::New(size_t size)
+{
+    void* p = size <= kMaxPooledSize ? NewPooled(ClassOf(size)) : std::malloc(size);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    ++stats_.allocations;
+    stats_.pooledAllocations += size <= kMaxPooledSize;
+    stats_.bytesInUse += size;
+    stats_.peakBytesInUse = std::max(stats_.peakBytesInUse, stats_.bytesInUse);
+    return p;
+}
+
+void LuaAllocator::Delete(void* ptr, size_t size)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    stats_.bytesInUse -= size;
+    if (size > kMaxPooledSize) {
+        std::free(ptr);
+        return;
+    }
+    auto sizeClass = ClassOf(size);
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = freeLists_[sizeClass];
+    freeLists_[sizeClass] = block;
+}
+
+void* LuaAllocator::NewPooled(size_t sizeClass)
+{
+    if (auto* block = freeLists_[sizeClass]) {
+        freeLists_[sizeClass] = block->next;
+        return block;
+    }
+    auto blockSize = (sizeClass + 1) * kGranularity;
+    if (cursor_ == nullptr || size_t(end_ - cursor_) < blockSize) {
+        auto* chunk = static_cast<char*>(std::malloc(kChunkSize));
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+        chunks_.push_back(chunk);
+        stats_.chunkBytes += kChunkSize;
+        cursor_ = chunk;
+        end_ = chunk + kChunkSize;
+    }
+    auto* p = cursor_;
+    cursor_ += blockSize;
+    return p;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The lua_Alloc of a work thread's Lua state. Most Lua objects are small (strings, tables, closures), they are carved
+// out of large chunks and recycled through a free list per size class, so the garbage a task leaves is reused by the
+// next one without going through malloc, which all the work threads share. Larger blocks go to malloc.
+// A state is only used by one thread, so nothing is locked.
+class LuaAllocator {
+public:
+    struct Stats {
+        size_t allocations { 0 };
+        size_t pooledAllocations { 0 };
+        size_t bytesInUse { 0 };
+        size_t peakBytesInUse { 0 };
+        size_t chunkBytes { 0 };
+    };
+
+    LuaAllocator() = default;
+    LuaAllocator(const LuaAllocator&) = delete;
+    LuaAllocator& operator=(const LuaAllocator&) = delete;
+    ~LuaAllocator();
+
+    // The lua_Alloc, ud is the LuaAllocator
+    static void* Allocate(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxPooledSize = 256;
+    static constexpr size_t kClassCount = kMaxPooledSize / kGranularity;
+    static constexpr size_t kChunkSize = 256 * 1024;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static size_t ClassOf(size_t size) { return (size - 1) / kGranularity; }
+
+    void* New(size_t size);
+    void Delete(void* ptr, size_t size);
+    void* NewPooled(size_t sizeClass);
+
+    FreeBlock* freeLists_[kClassCount] {};
+    std::vector<void*> chunks_ {};
+    char* cursor_ { nullptr };
+    char* end_ { nullptr };
+    Stats stats_ {};
+};
@@ -0,0 +1,198 @@
+#include "LuaKeepAlive.h"
+#include <new>
+
+namespace {
+
+// The innermost scope, they are only nested on the thread which runs the Lua state
+thread_local LuaKeepAlive::Scope* gCurrentScope = nullptr;
+
+// Their addresses are the registry keys and the marker of the owner tables
+const char kOwnerTablesKey = 0; // ParseState* -> owner table, weak values
+const char kKeptBytesKey = 0;
+const char kOwnerTableMarker = 0;
+const char kCapturedKey = 0; // the owner table Capture() got last
+const char kCacheKey = 0; // the field of an owner table which holds its cache, see PushCache()
+const char* const kAnchorMetatable = "ReflectionGen.KeepAlive";
+
+// Slot 1 of an owner table, the table is the user value of the userdata so that it works with LuaJIT's environments
+struct Anchor {
+    std::shared_ptr<const ParseState> owner;
+    size_t bytes;
+    size_t* keptBytes;
+};
+
+int DestroyAnchor(lua_State* L)
+{
+    auto* anchor = static_cast<Anchor*>(lua_touserdata(L, 1));
+    *anchor->keptBytes -= anchor->bytes;
+    anchor->~Anchor();
+    return 0;
+}
+
+void GetRegistryField(lua_State* L, const char* key)
+{
+    lua_pushlightuserdata(L, const_cast<char*>(key));
+    lua_rawget(L, LUA_REGISTRYINDEX);
+}
+
+void SetRegistryField(lua_State* L, const char* key)
+{
+    lua_pushlightuserdata(L, const_cast<char*>(key));
+    lua_insert(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+size_t* GetKeptBytesCounter(lua_State* L)
+{
+    GetRegistryField(L, &kKeptBytesKey);
+    auto* counter = static_cast<size_t*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    if (counter == nullptr) {
+        counter = new (lua_newuserdata(L, sizeof(size_t))) size_t { 0 };
+        SetRegistryField(L, &kKeptBytesKey);
+    }
+    return counter;
+}
+
+void PushOwnerTables(lua_State* L)
+{
+    GetRegistryField(L, &kOwnerTablesKey);
+    if (!lua_isnil(L, -1)) {
+        return;
+    }
+    lua_pop(L, 1);
+    lua_createtable(L, 0, 0);
+    lua_createtable(L, 0, 1);
+    lua_pushstring(L, "v");
+    lua_setfield(L, -2, "__mode");
+    lua_setmetatable(L, -2);
+    lua_pushvalue(L, -1);
+    SetRegistryField(L, &kOwnerTablesKey);
+}
+
+void PushAnchor(lua_State* L, std::shared_ptr<const ParseState> owner)
+{
+    auto* keptBytes = GetKeptBytesCounter(L);
+    size_t bytes = owner->arena_.GetBlockBytes();
+    new (lua_newuserdata(L, sizeof(Anchor))) Anchor { std::move(owner), bytes, keptBytes };
+    *keptBytes += bytes;
+    if (luaL_newmetatable(L, kAnchorMetatable) != 0) {
+        lua_pushcfunction(L, DestroyAnchor);
+        lua_setfield(L, -2, "__gc");
+    }
+    lua_setmetatable(L, -2);
+}
+
+bool IsOwnerTable(lua_State* L, int index)
+{
+    if (lua_type(L, index) != LUA_TTABLE) {
+        return false;
+    }
+    lua_pushlightuserdata(L, const_cast<char*>(&kOwnerTableMarker));
+    lua_rawget(L, index < 0 ? index - 1 : index);
+    bool marked = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return marked;
+}
+
+// Pushes the owner table of the ParseState, made on first use
+void PushOwnerTableOf(lua_State* L, std::shared_ptr<const ParseState> owner)
+{
+    PushOwnerTables(L);
+    lua_pushlightuserdata(L, const_cast<ParseState*>(owner.get()));
+    lua_rawget(L, -2);
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        lua_createtable(L, 1, 1);
+        lua_pushlightuserdata(L, const_cast<char*>(&kOwnerTableMarker));
+        lua_pushboolean(L, 1);
+        lua_rawset(L, -3);
+        lua_pushlightuserdata(L, const_cast<ParseState*>(owner.get()));
+        PushAnchor(L, std::move(owner));
+        lua_rawseti(L, -3, 1);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, -4);
+    }
+    lua_remove(L, -2);
+}
+
+} // namespace
+
+LuaKeepAlive::Scope::Scope(lua_State* L, std::shared_ptr<const ParseState> owner)
+    : L_ { L }
+    , previous_ { gCurrentScope }
+{
+    PushOwnerTableOf(L, std::move(owner));
+    ref_ = luaL_ref(L, LUA_REGISTRYINDEX);
+    gCurrentScope = this;
+}
+
+LuaKeepAlive::Scope::~Scope()
+{
+    luaL_unref(L_, LUA_REGISTRYINDEX, ref_);
+    gCurrentScope = previous_;
+}
+
+void LuaKeepAlive::Attach(lua_State* L)
+{
+    if (gCurrentScope != nullptr && gCurrentScope->L_ == L) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, gCurrentScope->ref_);
+    } else {
+        GetRegistryField(L, &kCapturedKey);
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            return;
+        }
+    }
+    lua_setuservalue(L, -2);
+}
+
+void LuaKeepAlive::Capture(lua_State* L, int index)
+{
+    if (!PushOwnerTable(L, index)) {
+        lua_pushnil(L);
+    }
+    SetRegistryField(L, &kCapturedKey);
+}
+
+void LuaKeepAlive::Capture(lua_State* L, std::shared_ptr<const ParseState> owner)
+{
+    PushOwnerTableOf(L, std::move(owner));
+    SetRegistryField(L, &kCapturedKey);
+}
+
+bool LuaKeepAlive::PushOwnerTable(lua_State* L, int index)
+{
+    if (lua_type(L, index) != LUA_TUSERDATA) {
+        return false;
+    }
+    lua_getuservalue(L, index);
+    if (!IsOwnerTable(L, -1)) {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+bool LuaKeepAlive::PushCache(lua_State* L, int index)
+{
+    if (!PushOwnerTable(L, index)) {
+        return false;
+    }
+    lua_pushlightuserdata(L, const_cast<char*>(&kCacheKey));
+    lua_rawget(L, -2);
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, 0);
+        lua_pushlightuserdata(L, const_cast<char*>(&kCacheKey));
+        lua_pushvalue(L, -2);
+        lua_rawset(L, -4);
+    }
+    lua_remove(L, -2);
+    return true;
+}
+
+size_t LuaKeepAlive::GetKeptBytes(lua_State* L)
+{
+    return *GetKeptBytesCounter(L);
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "Meta.h"
+#include "MetaTables.h"
+#include "ParseState.h"
+#include <memory>
+#include <sol/sol.hpp>
+
+// The userdata a script gets for a meta, a container or a view point into the ParseState which owns them, which is
+// freed once its task is done unless the type registry keeps it. So that a script may keep e.g. `clazz` or
+// `clazz.fields` in a global, each of these userdata gets an owner table as its user value, which holds a shared_ptr to
+// the ParseState. The table is the one of the Scope a callback argument is pushed in, else the one of the userdata the
+// call got last (sol reads `self` before it clears the stack and pushes the result), so it's passed along e.g. from
+// `clazz` to `clazz.fields` to `clazz.fields[1]`, or the one a TypeRecord property captures for its own ParseState.
+// The types are declared below with LUA_KEEP_ALIVE_*, the pushers and getters are sol's own plus Attach()/Capture().
+class LuaKeepAlive {
+public:
+    LuaKeepAlive() = delete;
+
+    // While it's alive, what C++ pushes onto L is owned by `owner`. There's one owner table per ParseState and Lua state
+    class Scope {
+    public:
+        Scope(lua_State* L, std::shared_ptr<const ParseState> owner);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+
+    private:
+        friend class LuaKeepAlive;
+
+        lua_State* L_;
+        int ref_;
+        Scope* previous_;
+    };
+
+    // Gives the userdata on the top of the stack its owner table, if any
+    static void Attach(lua_State* L);
+    // Remembers the owner table of the userdata at index (or that it has none) for the next Attach()
+    static void Capture(lua_State* L, int index);
+    // Makes `owner` the owner of what's pushed next, for a pointer which is got from neither a Scope nor a userdata
+    static void Capture(lua_State* L, std::shared_ptr<const ParseState> owner);
+    // Pushes the owner table of the userdata at index and returns true, or pushes nothing and returns false
+    static bool PushOwnerTable(lua_State* L, int index);
+    // Pushes the table in which the values built from the ParseState of the userdata at index are cached, so that
+    // they're built once per Lua state, or pushes nothing and returns false if the userdata has no owner
+    static bool PushCache(lua_State* L, int index);
+    // The bytes of the ParseStates the Lua state keeps alive, its collector doesn't know about them
+    static size_t GetKeptBytes(lua_State* L);
+
+    // sol's unqualified_pusher<detail::as_pointer_tag<T>>, T is possibly const
+    template <typename T>
+    struct PointerPusher {
+        using U = sol::meta::unqualified_t<T>;
+
+        template <typename F>
+        static int push_fx(lua_State* L, F&& f, T* obj)
+        {
+            if (obj == nullptr) {
+                return sol::stack::push(L, sol::lua_nil);
+            }
+            T** pref = sol::detail::usertype_allocate_pointer<T>(L);
+            f();
+            *pref = obj;
+            Attach(L);
+            return 1;
+        }
+
+        template <typename K>
+        static int push_keyed(lua_State* L, K&& k, T* obj)
+        {
+            sol::stack::stack_detail::undefined_metatable fx(L, &k[0], &sol::stack::stack_detail::set_undefined_methods_on<U*>);
+            return push_fx(L, fx, obj);
+        }
+
+        template <typename Arg, typename... Args>
+        static int push(lua_State* L, Arg&& arg, Args&&... args)
+        {
+            if constexpr (std::is_same_v<sol::meta::unqualified_t<Arg>, sol::detail::with_function_tag>) {
+                return push_fx(L, std::forward<Args>(args)...);
+            } else {
+                return push_keyed(L, sol::usertype_traits<U*>::metatable(), std::forward<Arg>(arg), std::forward<Args>(args)...);
+            }
+        }
+    };
+
+    // sol's unqualified_pusher<detail::as_value_tag<T>>, for the views which point into the ParseState
+    template <typename T>
+    struct ValuePusher {
+        template <typename F, typename... Args>
+        static int push_fx(lua_State* L, F&& f, Args&&... args)
+        {
+            T* obj = sol::detail::usertype_allocate<T>(L);
+            f();
+            std::allocator<T> alloc {};
+            std::allocator_traits<std::allocator<T>>::construct(alloc, obj, std::forward<Args>(args)...);
+            Attach(L);
+            return 1;
+        }
+
+        template <typename K, typename... Args>
+        static int push_keyed(lua_State* L, K&& k, Args&&... args)
+        {
+            sol::stack::stack_detail::undefined_metatable fx(L, &k[0], &sol::stack::stack_detail::set_undefined_methods_on<T>);
+            return push_fx(L, fx, std::forward<Args>(args)...);
+        }
+
+        template <typename Arg, typename... Args>
+        static int push(lua_State* L, Arg&& arg, Args&&... args)
+        {
+            if constexpr (std::is_same_v<sol::meta::unqualified_t<Arg>, sol::detail::with_function_tag>) {
+                return push_fx(L, std::forward<Args>(args)...);
+            } else {
+                return push_keyed(L, sol::usertype_traits<T>::metatable(), std::forward<Arg>(arg), std::forward<Args>(args)...);
+            }
+        }
+
+        static int push(lua_State* L) { return push_keyed(L, sol::usertype_traits<T>::metatable()); }
+    };
+
+    // sol's unqualified_getter<detail::as_value_tag<T>>, which all the gets of T&, T* and self go through
+    template <typename T>
+    struct ValueGetter {
+        static T* get_no_lua_nil(lua_State* L, int index, sol::stack::record& tracking)
+        {
+            tracking.use(1);
+            void* rawdata = sol::detail::align_usertype_pointer(lua_touserdata(L, index));
+            return get_no_lua_nil_from(L, *static_cast<void**>(rawdata), index, tracking);
+        }
+
+        static T* get_no_lua_nil_from(lua_State* L, void* udata, int index, sol::stack::record&)
+        {
+            Capture(L, index);
+            if (sol::derive<T>::value || sol::weak_derive<T>::value) {
+                if (lua_getmetatable(L, index) == 1) {
+                    lua_getfield(L, -1, &sol::detail::base_class_cast_key()[0]);
+                    if (sol::type_of(L, -1) != sol::type::lua_nil) {
+                        auto cast = reinterpret_cast<sol::detail::inheritance_cast_function>(lua_touserdata(L, -1));
+                        udata = cast(udata, sol::usertype_traits<T>::qualified_name());
+                    }
+                    lua_pop(L, 2);
+                }
+            }
+            return static_cast<T*>(udata);
+        }
+
+        static T& get(lua_State* L, int index, sol::stack::record& tracking) { return *get_no_lua_nil(L, index, tracking); }
+    };
+
+    // sol's unqualified_pusher<detail::as_unique_tag<T>>, e.g. for the shared_ptr<Namespace> children
+    template <typename T>
+    struct UniquePusher {
+        template <typename... Args>
+        static int push(lua_State* L, Args&&... args)
+        {
+            int pushed = sol::stack::stack_detail::uu_pusher<T> {}.push(L, std::forward<Args>(args)...);
+            if (lua_type(L, -1) == LUA_TUSERDATA) {
+                Attach(L);
+            }
+            return pushed;
+        }
+    };
+};
+
+// They have to be seen by all the translation units which push or get these types, before any use
+#define LUA_KEEP_ALIVE_GETTER(...)                                                                                                  \
+    template <>                                                                                                                     \
+    struct sol::stack::unqualified_getter<sol::detail::as_value_tag<__VA_ARGS__>> : LuaKeepAlive::ValueGetter<__VA_ARGS__> { };     \
+    template <>                                                                                                                     \
+    struct sol::stack::unqualified_getter<sol::detail::as_value_tag<const __VA_ARGS__>> : LuaKeepAlive::ValueGetter<const __VA_ARGS__> { };
+#define LUA_KEEP_ALIVE_POINTER(...)                                                                                                 \
+    LUA_KEEP_ALIVE_GETTER(__VA_ARGS__)                                                                                              \
+    template <>                                                                                                                     \
+    struct sol::stack::unqualified_pusher<sol::detail::as_pointer_tag<__VA_ARGS__>> : LuaKeepAlive::PointerPusher<__VA_ARGS__> { }; \
+    template <>                                                                                                                     \
+    struct sol::stack::unqualified_pusher<sol::detail::as_pointer_tag<const __VA_ARGS__>> : LuaKeepAlive::PointerPusher<const __VA_ARGS__> { };
+#define LUA_KEEP_ALIVE_VALUE(...)                                                                                                   \
+    LUA_KEEP_ALIVE_GETTER(__VA_ARGS__)                                                                                              \
+    template <>                                                                                                                     \
+    struct sol::stack::unqualified_pusher<sol::detail::as_value_tag<__VA_ARGS__>> : LuaKeepAlive::ValuePusher<__VA_ARGS__> { };
+#define LUA_KEEP_ALIVE_UNIQUE(...)                                                                                                  \
+    template <>                                                                                                                     \
+    struct sol::stack::unqualified_pusher<sol::detail::as_unique_tag<__VA_ARGS__>> : LuaKeepAlive::UniquePusher<__VA_ARGS__> { };
+
+LUA_KEEP_ALIVE_POINTER(ParseState)
+LUA_KEEP_ALIVE_POINTER(ParseState::ClassMap)
+LUA_KEEP_ALIVE_POINTER(ParseState::EnumMap)
+LUA_KEEP_ALIVE_POINTER(Namespace)
+LUA_KEEP_ALIVE_POINTER(decltype(Namespace::children))
+LUA_KEEP_ALIVE_UNIQUE(std::shared_ptr<Namespace>)
+LUA_KEEP_ALIVE_POINTER(ClassMeta)
+LUA_KEEP_ALIVE_POINTER(EnumMeta)
+LUA_KEEP_ALIVE_POINTER(ConstructorMeta)
+LUA_KEEP_ALIVE_POINTER(MethodMeta)
+LUA_KEEP_ALIVE_POINTER(FieldMeta)
+LUA_KEEP_ALIVE_POINTER(NamedObject)
+LUA_KEEP_ALIVE_POINTER(EnumValue)
+LUA_KEEP_ALIVE_POINTER(std::vector<ClassMeta*>)
+LUA_KEEP_ALIVE_POINTER(std::vector<EnumMeta*>)
+LUA_KEEP_ALIVE_POINTER(std::vector<ConstructorMeta*>)
+LUA_KEEP_ALIVE_POINTER(std::vector<MethodMeta*>)
+LUA_KEEP_ALIVE_POINTER(std::vector<FieldMeta*>)
+LUA_KEEP_ALIVE_POINTER(std::vector<InternedString>)
+LUA_KEEP_ALIVE_POINTER(ArenaVector<ConstructorMeta*>)
+LUA_KEEP_ALIVE_POINTER(ArenaVector<MethodMeta*>)
+LUA_KEEP_ALIVE_POINTER(ArenaVector<FieldMeta*>)
+LUA_KEEP_ALIVE_POINTER(ArenaVector<NamedObject>)
+LUA_KEEP_ALIVE_POINTER(ArenaVector<EnumValue>)
+LUA_KEEP_ALIVE_POINTER(ArenaVector<InternedString>)
+LUA_KEEP_ALIVE_POINTER(AnnotationMap)
+LUA_KEEP_ALIVE_POINTER(AnnotatedEntities)
+LUA_KEEP_ALIVE_POINTER(MetaTables)
+LUA_KEEP_ALIVE_POINTER(FieldTable)
+LUA_KEEP_ALIVE_POINTER(MethodTable)
+LUA_KEEP_ALIVE_POINTER(ArgumentTable)
+LUA_KEEP_ALIVE_POINTER(EnumValueTable)
+LUA_KEEP_ALIVE_VALUE(FieldView)
+LUA_KEEP_ALIVE_VALUE(ArgumentView)
+LUA_KEEP_ALIVE_VALUE(MethodView)
+LUA_KEEP_ALIVE_VALUE(EnumValueView)
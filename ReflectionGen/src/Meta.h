@@ -1,51 +1,114 @@
 #pragma once
+#include "Annotation.h"
+#include "InternedString.h"
+#include "MetaArena.h"
 #include "Namespace.h"
-#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Names, type spellings and annotations repeat a lot across a code base, e.g. int or std::string&,
+// so they are interned instead of being stored again in every meta
 struct NamedObject {
-    std::string name;
-    std::string type;
+    InternedString name;
+    InternedString type;
 };
 struct EnumValue {
-    std::string name;
-    std::string value;
+    InternedString name;
+    InternedString value;
 };
 struct BaseMeta : public NamedObject {
-    std::vector<std::string> annotations;
-    Namespace* namespace_;
+    explicit BaseMeta(MetaArena& arena)
+        : annotations { ArenaAllocator<InternedString> { arena } }
+    {
+    }
+
+    ArenaVector<InternedString> annotations;
+    // The annotations parsed into key -> typed value, see AnnotationParser
+    AnnotationMap annotationMap;
+    Namespace* namespace_ {};
+    // Computed once when the meta is created, see SetName(), it points into the arena which owns the meta
+    std::string_view fullName;
+
+    std::string_view GetFullName() const { return fullName; }
+
+    void SetName(InternedString n, Namespace* ns, MetaArena& arena)
+    {
+        name = n;
+        namespace_ = ns;
+        fullName = ns->Qualify(n.str(), arena);
+    }
 
-    std::string GetFullName() const
+    void SetAnnotations(const std::vector<InternedString>& items)
     {
-        return namespace_->GetFullName() + "::" + name;
+        annotations.assign(items.begin(), items.end());
+        AnnotationParser::BuildMap(annotations, annotationMap);
     }
 };
 
+// The metas are created by their ParseState's arena, e.g. arena.New<FieldMeta>(arena), their lists are allocated from it
 struct MethodMeta : public BaseMeta {
-    bool isStatic;
+    explicit MethodMeta(MetaArena& arena)
+        : BaseMeta { arena }
+        , arguments { ArenaAllocator<NamedObject> { arena } }
+    {
+    }
+
+    bool isStatic {};
 
-    std::string returnType;
-    std::vector<NamedObject> arguments;
+    InternedString returnType;
+    ArenaVector<NamedObject> arguments;
 };
 
 struct ConstructorMeta : public BaseMeta {
-    std::vector<NamedObject> arguments;
+    explicit ConstructorMeta(MetaArena& arena)
+        : BaseMeta { arena }
+        , arguments { ArenaAllocator<NamedObject> { arena } }
+    {
+    }
+
+    ArenaVector<NamedObject> arguments;
 };
 
 struct FieldMeta : public BaseMeta {
-    bool isStatic;
+    explicit FieldMeta(MetaArena& arena)
+        : BaseMeta { arena }
+    {
+    }
+
+    bool isStatic {};
 };
 
-struct EnumMeta : public BaseMeta {
-    bool isClass;
-    std::string underlyingType;
-    std::vector<EnumValue> values;
+// Digest of all the extracted metadata of a class/enum, and whether it's the same as the last run's
+struct StructuralHash {
+    uint64_t structuralHash {};
+    bool unchangedSinceLastRun { false };
+};
+
+struct EnumMeta : public BaseMeta, public StructuralHash {
+    explicit EnumMeta(MetaArena& arena)
+        : BaseMeta { arena }
+        , values { ArenaAllocator<EnumValue> { arena } }
+    {
+    }
+
+    bool isClass {};
+    InternedString underlyingType;
+    ArenaVector<EnumValue> values;
 };
 
-struct ClassMeta : public BaseMeta {
-    bool isAbstract;
-    std::vector<std::shared_ptr<ConstructorMeta>> constructors;
-    std::vector<std::shared_ptr<MethodMeta>> methods;
-    std::vector<std::shared_ptr<FieldMeta>> fields;
-};
\ No newline at end of file
+// Owned by the ParseState's arena, so the graph only holds plain pointers
+struct ClassMeta : public BaseMeta, public StructuralHash {
+    explicit ClassMeta(MetaArena& arena)
+        : BaseMeta { arena }
+        , constructors { ArenaAllocator<ConstructorMeta*> { arena } }
+        , methods { ArenaAllocator<MethodMeta*> { arena } }
+        , fields { ArenaAllocator<FieldMeta*> { arena } }
+    {
+    }
+
+    bool isAbstract {};
+    ArenaVector<ConstructorMeta*> constructors;
+    ArenaVector<MethodMeta*> methods;
+    ArenaVector<FieldMeta*> fields;
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A bump allocator which owns all the meta objects of a translation unit. Objects are carved out of large blocks
+// and never freed one by one, the destructors are recorded in an intrusive list and run all at once by Reset(),
+// so a TU with tens of thousands of entities costs a few block allocations instead of one allocation each.
+class MetaArena {
+public:
+    MetaArena() = default;
+    MetaArena(const MetaArena&) = delete;
+    MetaArena& operator=(const MetaArena&) = delete;
+
+    ~MetaArena()
+    {
+        Reset();
+        FreeBlock(head_);
+        head_ = nullptr;
+    }
+
+    template <typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        } else {
+            auto* node = static_cast<Destructor*>(Allocate(sizeof(Destructor), alignof(Destructor)));
+            auto* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            node->object = object;
+            node->destroy = [](void* p) { static_cast<T*>(p)->~T(); };
+            node->next = destructors_;
+            destructors_ = node;
+            return object;
+        }
+    }
+
+    void* Allocate(size_t size, size_t alignment)
+    {
+        auto aligned = (cursor_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (head_ == nullptr || aligned + size > end_) {
+            AddBlock(size + alignment);
+            aligned = (cursor_ + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        }
+        cursor_ = aligned + size;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // What the arena holds on to, whether it's used or not
+    size_t GetBlockBytes() const
+    {
+        size_t bytes = 0;
+        for (auto* block = head_; block != nullptr; block = block->prev) {
+            bytes += block->size;
+        }
+        return bytes;
+    }
+
+    // Destroy all the objects, only the latest (largest) block is kept for reuse
+    void Reset()
+    {
+        for (auto* node = destructors_; node != nullptr; node = node->next) {
+            node->destroy(node->object);
+        }
+        destructors_ = nullptr;
+        if (head_ != nullptr) {
+            FreeBlock(head_->prev);
+            head_->prev = nullptr;
+            cursor_ = reinterpret_cast<uintptr_t>(head_ + 1);
+        }
+    }
+
+private:
+    struct Destructor {
+        Destructor* next;
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    struct alignas(std::max_align_t) Block {
+        Block* prev;
+        size_t size;
+    };
+
+    static constexpr size_t kMinBlockSize = 16 * 1024;
+    static constexpr size_t kMaxBlockSize = 1024 * 1024;
+
+    void AddBlock(size_t minSize)
+    {
+        auto size = std::max(nextBlockSize_, minSize + sizeof(Block));
+        nextBlockSize_ = std::min(nextBlockSize_ * 2, kMaxBlockSize);
+        auto* block = static_cast<Block*>(std::malloc(size));
+        if (block == nullptr) {
+            throw std::bad_alloc();
+        }
+        block->prev = head_;
+        block->size = size;
+        head_ = block;
+        cursor_ = reinterpret_cast<uintptr_t>(block + 1);
+        end_ = reinterpret_cast<uintptr_t>(block) + size;
+    }
+
+    static void FreeBlock(Block* block)
+    {
+        while (block != nullptr) {
+            auto* prev = block->prev;
+            std::free(block);
+            block = prev;
+        }
+    }
+
+private:
+    Block* head_ { nullptr };
+    uintptr_t cursor_ { 0 };
+    uintptr_t end_ { 0 };
+    size_t nextBlockSize_ { kMinBlockSize };
+    Destructor* destructors_ { nullptr };
+};
+
+// Makes the containers of the metas take their memory from the arena too, so that e.g. the fields of a class cost no
+// allocation of their own. Nothing is freed until the arena is: growing a vector leaves its previous buffer behind,
+// at most as much as it ends up holding. A default constructed allocator has no arena and uses the heap, it's only
+// for the empty lists which stand for a missing one.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(MetaArena& arena)
+        : arena_ { &arena }
+    {
+    }
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : arena_ { other.arena_ }
+    {
+    }
+
+    T* allocate(size_t n)
+    {
+        if (arena_ == nullptr) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+        if (arena_ == nullptr) {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const
+    {
+        return arena_ == other.arena_;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    MetaArena* arena_ { nullptr };
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "Meta.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Struct of arrays copy of the member metadata of a file. A bulk scan walks the columns it needs instead of chasing
+// ClassMeta -> FieldMeta pointers. The flags and indices are stored inline, but the string columns only hold
+// InternedStrings, i.e. pointers into the string pool, comparing them is cheap while reading their text is not.
+// Rows refer to their owners by index, all the indices are 0 based.
+struct FieldTable {
+    std::vector<InternedString> name;
+    std::vector<InternedString> type;
+    std::vector<uint8_t> isStatic;
+    std::vector<uint32_t> owner; // in ParseState::classList_
+
+    size_t Size() const { return name.size(); }
+};
+
+// Both the methods and the constructors
+struct MethodTable {
+    enum Flags : uint8_t {
+        kStatic = 1U << 0U,
+        kConstructor = 1U << 1U,
+    };
+    std::vector<InternedString> name;
+    std::vector<InternedString> type;
+    std::vector<InternedString> returnType; // empty for constructors
+    std::vector<uint8_t> flags;
+    std::vector<uint32_t> owner;         // in ParseState::classList_
+    std::vector<uint32_t> firstArgument; // in ArgumentTable
+    std::vector<uint32_t> argumentCount;
+
+    size_t Size() const { return name.size(); }
+};
+
+struct ArgumentTable {
+    std::vector<InternedString> name;
+    std::vector<InternedString> type;
+    std::vector<uint32_t> owner; // in MethodTable
+
+    size_t Size() const { return name.size(); }
+};
+
+struct EnumValueTable {
+    std::vector<InternedString> name;
+    std::vector<InternedString> value;
+    std::vector<uint32_t> owner; // in ParseState::enumList_
+
+    size_t Size() const { return name.size(); }
+};
+
+struct MetaTables;
+
+// Lightweight views of a row, what the scripts get instead of a meta object
+struct FieldView {
+    const MetaTables* tables;
+    uint32_t index;
+
+    const InternedString& Name() const;
+    const InternedString& Type() const;
+    bool IsStatic() const;
+    ClassMeta* Owner() const;
+};
+
+struct ArgumentView {
+    const MetaTables* tables;
+    uint32_t index;
+
+    const InternedString& Name() const;
+    const InternedString& Type() const;
+};
+
+struct MethodView {
+    const MetaTables* tables;
+    uint32_t index;
+
+    const InternedString& Name() const;
+    const InternedString& Type() const;
+    const InternedString& ReturnType() const;
+    bool IsStatic() const;
+    bool IsConstructor() const;
+    ClassMeta* Owner() const;
+    uint32_t ArgumentCount() const;
+    // 0 based, nullopt if out of range
+    std::optional<ArgumentView> Argument(uint32_t i) const;
+};
+
+struct EnumValueView {
+    const MetaTables* tables;
+    uint32_t index;
+
+    const InternedString& Name() const;
+    const InternedString& Value() const;
+    EnumMeta* Owner() const;
+};
+
+struct MetaTables {
+    FieldTable fields;
+    MethodTable methods;
+    ArgumentTable arguments;
+    EnumValueTable enumValues;
+    const std::vector<ClassMeta*>* classes {};
+    const std::vector<EnumMeta*>* enums {};
+
+    void Build(const std::vector<ClassMeta*>& classList, const std::vector<EnumMeta*>& enumList)
+    {
+        classes = &classList;
+        enums = &enumList;
+        for (uint32_t classIndex = 0; classIndex < classList.size(); ++classIndex) {
+            auto* classMeta = classList[classIndex];
+            for (auto* field : classMeta->fields) {
+                fields.name.push_back(field->name);
+                fields.type.push_back(field->type);
+                fields.isStatic.push_back(field->isStatic);
+                fields.owner.push_back(classIndex);
+            }
+            for (auto* ctor : classMeta->constructors) {
+                AddMethod(*ctor, {}, MethodTable::kConstructor, classIndex, ctor->arguments);
+            }
+            for (auto* method : classMeta->methods) {
+                AddMethod(*method, method->returnType, method->isStatic ? MethodTable::kStatic : 0, classIndex, method->arguments);
+            }
+        }
+        for (uint32_t enumIndex = 0; enumIndex < enumList.size(); ++enumIndex) {
+            for (auto& value : enumList[enumIndex]->values) {
+                enumValues.name.push_back(value.name);
+                enumValues.value.push_back(value.value);
+                enumValues.owner.push_back(enumIndex);
+            }
+        }
+    }
+
+    // 0 based, nullopt if out of range
+    std::optional<FieldView> Field(uint32_t i) const
+    {
+        return i < fields.Size() ? std::optional<FieldView> { FieldView { this, i } } : std::nullopt;
+    }
+    std::optional<MethodView> Method(uint32_t i) const
+    {
+        return i < methods.Size() ? std::optional<MethodView> { MethodView { this, i } } : std::nullopt;
+    }
+    std::optional<ArgumentView> Argument(uint32_t i) const
+    {
+        return i < arguments.Size() ? std::optional<ArgumentView> { ArgumentView { this, i } } : std::nullopt;
+    }
+    std::optional<EnumValueView> EnumValue(uint32_t i) const
+    {
+        return i < enumValues.Size() ? std::optional<EnumValueView> { EnumValueView { this, i } } : std::nullopt;
+    }
+
+private:
+    void AddMethod(const BaseMeta& meta, const InternedString& returnType, uint8_t flags, uint32_t classIndex, const ArenaVector<NamedObject>& args)
+    {
+        auto methodIndex = uint32_t(methods.Size());
+        methods.name.push_back(meta.name);
+        methods.type.push_back(meta.type);
+        methods.returnType.push_back(returnType);
+        methods.flags.push_back(flags);
+        methods.owner.push_back(classIndex);
+        methods.firstArgument.push_back(uint32_t(arguments.Size()));
+        methods.argumentCount.push_back(uint32_t(args.size()));
+        for (auto& arg : args) {
+            arguments.name.push_back(arg.name);
+            arguments.type.push_back(arg.type);
+            arguments.owner.push_back(methodIndex);
+        }
+    }
+};
+
+inline const InternedString& FieldView::Name() const { return tables->fields.name[index]; }
+inline const InternedString& FieldView::Type() const { return tables->fields.type[index]; }
+inline bool FieldView::IsStatic() const { return tables->fields.isStatic[index] != 0; }
+inline ClassMeta* FieldView::Owner() const { return (*tables->classes)[tables->fields.owner[index]]; }
+
+inline const InternedString& ArgumentView::Name() const { return tables->arguments.name[index]; }
+inline const InternedString& ArgumentView::Type() const { return tables->arguments.type[index]; }
+
+inline const InternedString& MethodView::Name() const { return tables->methods.name[index]; }
+inline const InternedString& MethodView::Type() const { return tables->methods.type[index]; }
+inline const InternedString& MethodView::ReturnType() const { return tables->methods.returnType[index]; }
+inline bool MethodView::IsStatic() const { return (tables->methods.flags[index] & MethodTable::kStatic) != 0; }
+inline bool MethodView::IsConstructor() const { return (tables->methods.flags[index] & MethodTable::kConstructor) != 0; }
+inline ClassMeta* MethodView::Owner() const { return (*tables->classes)[tables->methods.owner[index]]; }
+inline uint32_t MethodView::ArgumentCount() const { return tables->methods.argumentCount[index]; }
+inline std::optional<ArgumentView> MethodView::Argument(uint32_t i) const
+{
+    if (i >= ArgumentCount()) {
+        return std::nullopt;
+    }
+    return ArgumentView { tables, tables->methods.firstArgument[index] + i };
+}
+
+inline const InternedString& EnumValueView::Name() const { return tables->enumValues.name[index]; }
+inline const InternedString& EnumValueView::Value() const { return tables->enumValues.value[index]; }
+inline EnumMeta* EnumValueView::Owner() const { return (*tables->enums)[tables->enumValues.owner[index]]; }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "InternedString.h"
+#include "MetaArena.h"
+#include <cstring>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -9,18 +12,21 @@ struct Namespace {
         : name(std::move(name))
         , parent(parent)
         , isStruct { isStruct }
+        , fullName_ { parent == nullptr ? std::string {} : parent->GetFullName() + "::" + this->name }
     {
     }
 
-    const std::string& GetFullName() const
+    const std::string& GetFullName() const { return fullName_.str(); }
+
+    // The full name of a child entity, stored in the arena which owns the entity
+    std::string_view Qualify(std::string_view childName, MetaArena& arena) const
     {
-        if (parent == nullptr) {
-            return name;
-        }
-        if (fullName_.empty()) {
-            fullName_ = parent->GetFullName() + "::" + name;
-        }
-        return fullName_;
+        auto size = fullName_.size() + 2 + childName.size();
+        auto* p = static_cast<char*>(arena.Allocate(size, 1));
+        std::memcpy(p, fullName_.c_str(), fullName_.size());
+        std::memcpy(p + fullName_.size(), "::", 2);
+        std::memcpy(p + fullName_.size() + 2, childName.data(), childName.size());
+        return { p, size };
     }
 
     std::string name {};
@@ -29,7 +35,8 @@ struct Namespace {
     std::unordered_map<std::string, std::shared_ptr<Namespace>> children;
 
 private:
-    mutable std::string fullName_ {};
+    // Namespaces are shared by lots of metas and files, so it's interned
+    InternedString fullName_;
 };
 
 class NamespaceState {
@@ -49,6 +56,8 @@ public:
         return current_;
     }
     Namespace* Current() const { return current_; };
+    Namespace* Root() { return &root_; }
+    const Namespace* Root() const { return &root_; }
 
 private:
     Namespace root_ { "", nullptr };
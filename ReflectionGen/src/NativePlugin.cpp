@@ -0,0 +1,75 @@
+#include "NativePlugin.h"
+#include "FileUtils.h"
+#include <iostream>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+static int HostMakeDirsForFile(const char* filePath)
+{
+    if (!FileUtils::MakeDirsForFile(filePath)) {
+        std::cerr << "Failed to create the directories of " << filePath << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static int HostWriteFile(const char* filePath, const char* data, size_t size)
+{
+    return FileUtils::WriteFile(filePath, std::string_view(data, size)) ? 0 : 1;
+}
+
+static const RgHost kHost {
+    RG_PLUGIN_API_VERSION,
+    HostMakeDirsForFile,
+    HostWriteFile,
+};
+
+const RgHost* NativePlugin::GetHost()
+{
+    return &kHost;
+}
+
+NativePlugin::~NativePlugin()
+{
+    if (handle_ == nullptr) {
+        return;
+    }
+#if defined(_WIN32)
+    FreeLibrary(static_cast<HMODULE>(handle_));
+#else
+    dlclose(handle_);
+#endif
+}
+
+bool NativePlugin::Load(const std::string& path)
+{
+    path_ = path;
+#if defined(_WIN32)
+    handle_ = LoadLibraryA(path.c_str());
+    if (handle_ == nullptr) {
+        std::cerr << "Failed to load plugin " << path << ", error code: " << GetLastError() << std::endl;
+        return false;
+    }
+    auto getPlugin = reinterpret_cast<RgGetPluginFunction>(GetProcAddress(static_cast<HMODULE>(handle_), RG_GET_PLUGIN_FUNCTION_NAME));
+#else
+    handle_ = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle_ == nullptr) {
+        std::cerr << "Failed to load plugin " << path << ": " << dlerror() << std::endl;
+        return false;
+    }
+    auto getPlugin = reinterpret_cast<RgGetPluginFunction>(dlsym(handle_, RG_GET_PLUGIN_FUNCTION_NAME));
+#endif
+    if (getPlugin == nullptr) {
+        std::cerr << "Plugin " << path << " doesn't export " << RG_GET_PLUGIN_FUNCTION_NAME << std::endl;
+        return false;
+    }
+    plugin_ = getPlugin(RG_PLUGIN_API_VERSION);
+    if (plugin_ == nullptr || plugin_->apiVersion != RG_PLUGIN_API_VERSION) {
+        std::cerr << "Plugin " << path << " doesn't support the API version " << RG_PLUGIN_API_VERSION << std::endl;
+        return false;
+    }
+    return true;
+}
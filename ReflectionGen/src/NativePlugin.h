@@ -0,0 +1,26 @@
+#pragma once
+
+#include "FfiTables.h" // the host includes ReflectionGenPlugin.h through it, which keeps the text of the types
+#include <string>
+
+// A generator written in C/C++, loaded from a shared library, see ReflectionGenPlugin.h
+class NativePlugin {
+public:
+    NativePlugin() = default;
+    NativePlugin(const NativePlugin&) = delete;
+    NativePlugin& operator=(const NativePlugin&) = delete;
+    ~NativePlugin();
+
+    bool Load(const std::string& path);
+
+    const RgPlugin& Get() const { return *plugin_; }
+    const std::string& GetPath() const { return path_; }
+
+    // The services passed to CreateContext
+    static const RgHost* GetHost();
+
+private:
+    std::string path_ {};
+    void* handle_ { nullptr };
+    const RgPlugin* plugin_ { nullptr };
+};
@@ -0,0 +1,110 @@
+#include "OutputWriter.h"
+#include "FileUtils.h"
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+
+static thread_local std::vector<std::string> tCurrentInputFiles {};
+
+// The same file may be given as 'out/a.h', './out/a.h' or an absolute path, which have to go to the same shard so that
+// its writes stay in order
+static std::string NormalizePath(const std::string& path)
+{
+    std::error_code ec;
+    auto p = std::filesystem::absolute(path, ec);
+    if (ec) {
+        return path;
+    }
+    return p.lexically_normal().string();
+}
+
+OutputWriter::OutputWriter(uint32_t threadsCount, size_t maxQueuedBytes)
+    : maxQueuedBytes_ { maxQueuedBytes }
+{
+    shards_.resize(std::max(threadsCount, 1U));
+    for (auto& shard : shards_) {
+        shard = std::make_unique<Shard>();
+        shard->thread = std::thread([this, &shard = *shard]() {
+            ThreadRoutine(shard);
+        });
+    }
+}
+
+OutputWriter::~OutputWriter()
+{
+    Finish();
+}
+
+void OutputWriter::Write(std::string path, std::string data)
+{
+    {
+        // A single file bigger than the limit is still queued, once nothing else is
+        std::unique_lock<std::mutex> lck(queuedBytesMutex_);
+        queuedBytesCv_.wait(lck, [&]() { return queuedBytes_ == 0 || queuedBytes_ + data.size() <= maxQueuedBytes_; });
+        queuedBytes_ += data.size();
+    }
+    auto& shard = *shards_[std::hash<std::string> {}(NormalizePath(path)) % shards_.size()];
+    {
+        std::lock_guard<std::mutex> lck(shard.mutex);
+        shard.queue.push({ std::move(path), std::move(data), tCurrentInputFiles });
+    }
+    shard.cv.notify_one();
+}
+
+bool OutputWriter::Finish()
+{
+    for (auto& shard : shards_) {
+        {
+            std::lock_guard<std::mutex> lck(shard->mutex);
+            shard->closed = true;
+        }
+        shard->cv.notify_one();
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+    return stats_.failed == 0;
+}
+
+void OutputWriter::SetCurrentInputFiles(std::vector<std::string> inputFiles)
+{
+    tCurrentInputFiles = std::move(inputFiles);
+}
+
+void OutputWriter::ThreadRoutine(Shard& shard)
+{
+    while (true) {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lck(shard.mutex);
+            shard.cv.wait(lck, [&]() { return !shard.queue.empty() || shard.closed; });
+            if (shard.queue.empty()) {
+                return;
+            }
+            item = std::move(shard.queue.front());
+            shard.queue.pop();
+        }
+        WriteNow(item);
+        {
+            std::lock_guard<std::mutex> lck(queuedBytesMutex_);
+            queuedBytes_ -= item.data.size();
+        }
+        queuedBytesCv_.notify_all();
+    }
+}
+
+void OutputWriter::WriteNow(const Item& item)
+{
+    bool unchanged = false;
+    if (!FileUtils::WriteFileIfChanged(item.path, item.data, unchanged)) {
+        ++stats_.failed;
+        std::lock_guard<std::mutex> lck(failedMutex_);
+        failedInputFiles_.insert(item.inputFiles.begin(), item.inputFiles.end());
+    } else if (unchanged) {
+        ++stats_.unchanged;
+    } else {
+        ++stats_.written;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Writes the generated files on threads of its own, so that the work threads hand the content over and go on instead of
+// waiting for the file system, which is slow on network shares. The files are written by FileUtils::WriteFileIfChanged().
+// The writes of a path always go to the same thread, so they're done in the order they were queued.
+class OutputWriter {
+public:
+    struct Stats {
+        std::atomic_uint64_t written { 0 };
+        std::atomic_uint64_t unchanged { 0 };
+        std::atomic_uint64_t failed { 0 };
+    };
+
+    // Write() waits while more than maxQueuedBytes are queued
+    OutputWriter(uint32_t threadsCount, size_t maxQueuedBytes);
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+    ~OutputWriter();
+
+    // The file is owned by the current input files of the calling thread
+    void Write(std::string path, std::string data);
+
+    // Waits for all the queued writes and stops the threads, returns false if any write failed
+    bool Finish();
+
+    const Stats& GetStats() const { return stats_; }
+
+    // The input files owning a file that failed to be written, to be generated again. Only valid after Finish()
+    const std::unordered_set<std::string>& GetFailedInputFiles() const { return failedInputFiles_; }
+
+    // The input files being generated by the calling thread, several for a batch
+    static void SetCurrentInputFiles(std::vector<std::string> inputFiles);
+
+private:
+    struct Item {
+        std::string path;
+        std::string data;
+        std::vector<std::string> inputFiles;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::queue<Item> queue;
+        bool closed { false };
+        std::thread thread;
+    };
+
+    void ThreadRoutine(Shard& shard);
+    void WriteNow(const Item& item);
+
+private:
+    std::vector<std::unique_ptr<Shard>> shards_ {};
+    size_t maxQueuedBytes_ {};
+    size_t queuedBytes_ { 0 };
+    std::mutex queuedBytesMutex_ {};
+    std::condition_variable queuedBytesCv_ {};
+    Stats stats_ {};
+    std::mutex failedMutex_ {};
+    std::unordered_set<std::string> failedInputFiles_ {};
+};
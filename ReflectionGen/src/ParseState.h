@@ -1,39 +1,303 @@
 #pragma once
 
+#include "FfiTables.h"
+#include "Hash.h"
+#include "Meta.h"
+#include "MetaArena.h"
+#include "MetaTables.h"
 #include "Namespace.h"
+#include <algorithm>
+#include <memory>
 #include <unordered_map>
 
-class ClassMeta;
+// The entities carrying a given annotation key, each list in source order
+struct AnnotatedEntities {
+    std::vector<ClassMeta*> classes;
+    std::vector<EnumMeta*> enums;
+    std::vector<ConstructorMeta*> constructors;
+    std::vector<MethodMeta*> methods;
+    std::vector<FieldMeta*> fields;
+};
+
+// A full name given as its namespace and its own name, so that the metas are looked up without building the string
+struct QualifiedName {
+    const Namespace* ns;
+    std::string_view name;
+};
+
+// The maps are keyed on the full names stored in the arena, a QualifiedName hashes and compares as its full name
+struct FullNameHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view fullName) const { return size_t(HashString(fullName)); }
+
+    size_t operator()(const QualifiedName& qualified) const
+    {
+        auto& nsName = qualified.ns->GetFullName();
+        Hasher hasher {};
+        hasher.Update(nsName.data(), nsName.size()).Update("::", 2).Update(qualified.name.data(), qualified.name.size());
+        return size_t(hasher.Digest());
+    }
+};
+
+struct FullNameEqual {
+    using is_transparent = void;
+
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+
+    bool operator()(const QualifiedName& qualified, std::string_view fullName) const
+    {
+        std::string_view nsName = qualified.ns->GetFullName();
+        return fullName.size() == nsName.size() + 2 + qualified.name.size() && fullName.substr(0, nsName.size()) == nsName
+            && fullName.substr(nsName.size(), 2) == "::" && fullName.substr(nsName.size() + 2) == qualified.name;
+    }
+
+    bool operator()(std::string_view fullName, const QualifiedName& qualified) const { return (*this)(qualified, fullName); }
+};
 
 struct ParseState {
-    using ClassMap = std::unordered_map<std::string, std::shared_ptr<ClassMeta>>;
-    using EnumMap = std::unordered_map<std::string, std::shared_ptr<EnumMeta>>;
+    // The keys point into the arena, they are the full names of the metas
+    using ClassMap = std::unordered_map<std::string_view, ClassMeta*, FullNameHash, FullNameEqual>;
+    using EnumMap = std::unordered_map<std::string_view, EnumMeta*, FullNameHash, FullNameEqual>;
 
+    // Owns all the metas below, they are freed at once with the ParseState. Except for the whole program given to
+    // 'OnAllFilesParsed', whose metas are owned by the ParseStates of the files, see TypeRegistry::CollectAll()
+    MetaArena arena_ {};
     NamespaceState namespaceState {};
     ClassMap classes_;
     EnumMap enums_;
+    // The same classes/enums in the order they first appear in the source file, the maps above iterate in
+    // hash order which differs between runs and standard libraries, this keeps the generated files byte-identical
+    std::vector<ClassMeta*> classList_;
+    std::vector<EnumMeta*> enumList_;
+    // Annotation key -> entities, see BuildAnnotationIndex()
+    std::unordered_map<InternedString, AnnotatedEntities> annotationIndex_;
+
+    // Whether anything in this file is annotated, i.e. whether the script may be interested in it
+    bool HasAnnotatedEntities() const
+    {
+        for (auto& [fullName, enumMeta] : enums_) {
+            if (IsAnnotated(*enumMeta)) {
+                return true;
+            }
+        }
+        for (auto& [fullName, classMeta] : classes_) {
+            if (IsAnnotated(*classMeta)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool IsAnnotated(const EnumMeta& meta) { return !meta.annotations.empty(); }
+
+    // The class itself or any of its members
+    static bool IsAnnotated(const ClassMeta& meta)
+    {
+        if (!meta.annotations.empty()) {
+            return true;
+        }
+        for (auto& ctor : meta.constructors) {
+            if (!ctor->annotations.empty()) {
+                return true;
+            }
+        }
+        for (auto& method : meta.methods) {
+            if (!method->annotations.empty()) {
+                return true;
+            }
+        }
+        for (auto& field : meta.fields) {
+            if (!field->annotations.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Nothing but declared, e.g. a forward declaration
+    static bool IsEmpty(const ClassMeta& meta)
+    {
+        return meta.annotations.empty() && meta.constructors.empty() && meta.methods.empty() && meta.fields.empty();
+    }
+
+    static bool IsEmpty(const EnumMeta& meta) { return meta.annotations.empty() && meta.values.empty(); }
+
+    void ComputeStructuralHashes()
+    {
+        for (auto& [fullName, classMeta] : classes_) {
+            classMeta->structuralHash = ComputeStructuralHash(*classMeta);
+        }
+        for (auto& [fullName, enumMeta] : enums_) {
+            enumMeta->structuralHash = ComputeStructuralHash(*enumMeta);
+        }
+    }
+
+    static uint64_t ComputeStructuralHash(const ClassMeta& classMeta)
+    {
+        Hasher hasher {};
+        HashBaseMeta(hasher, classMeta);
+        hasher.Update(uint64_t(classMeta.isAbstract));
+        hasher.Update(uint64_t(classMeta.constructors.size()));
+        for (auto& ctor : classMeta.constructors) {
+            HashBaseMeta(hasher, *ctor);
+            HashNamedObjects(hasher, ctor->arguments);
+        }
+        hasher.Update(uint64_t(classMeta.methods.size()));
+        for (auto& method : classMeta.methods) {
+            HashBaseMeta(hasher, *method);
+            hasher.Update(uint64_t(method->isStatic)).Update(method->returnType);
+            HashNamedObjects(hasher, method->arguments);
+        }
+        hasher.Update(uint64_t(classMeta.fields.size()));
+        for (auto& field : classMeta.fields) {
+            HashBaseMeta(hasher, *field);
+            hasher.Update(uint64_t(field->isStatic));
+        }
+        return hasher.Digest();
+    }
+
+    static uint64_t ComputeStructuralHash(const EnumMeta& enumMeta)
+    {
+        Hasher hasher {};
+        HashBaseMeta(hasher, enumMeta);
+        hasher.Update(uint64_t(enumMeta.isClass)).Update(enumMeta.underlyingType);
+        hasher.Update(uint64_t(enumMeta.values.size()));
+        for (auto& value : enumMeta.values) {
+            hasher.Update(value.name).Update(value.value);
+        }
+        return hasher.Digest();
+    }
+
+    // Build the inverted index, so that scripts can ask for e.g. all the fields with some annotation
+    // without visiting every meta
+    void BuildAnnotationIndex()
+    {
+        annotationIndex_.clear();
+        for (auto* classMeta : classList_) {
+            IndexAnnotations(classMeta, &AnnotatedEntities::classes);
+            for (auto* ctor : classMeta->constructors) {
+                IndexAnnotations(ctor, &AnnotatedEntities::constructors);
+            }
+            for (auto* method : classMeta->methods) {
+                IndexAnnotations(method, &AnnotatedEntities::methods);
+            }
+            for (auto* field : classMeta->fields) {
+                IndexAnnotations(field, &AnnotatedEntities::fields);
+            }
+        }
+        for (auto* enumMeta : enumList_) {
+            IndexAnnotations(enumMeta, &AnnotatedEntities::enums);
+        }
+    }
+
+    // The columnar copy of the members, built on first use, as most scripts never ask for it
+    const MetaTables* GetTables() const
+    {
+        if (tables_ == nullptr) {
+            tables_ = std::make_unique<MetaTables>();
+            tables_->Build(classList_, enumList_);
+        }
+        return tables_.get();
+    }
+
+    // The C view of the tables for LuaJIT's FFI, built on first use as well
+    const FfiTables* GetFfiTables() const
+    {
+        if (ffiTables_ == nullptr) {
+            ffiTables_ = std::make_unique<FfiTables>();
+            ffiTables_->Build(*GetTables());
+        }
+        return ffiTables_.get();
+    }
+
+    // Never null, all the lists are empty if no entity has the key
+    const AnnotatedEntities* Find(const InternedString& key) const
+    {
+        static const AnnotatedEntities empty {};
+        auto it = annotationIndex_.find(key);
+        return it != annotationIndex_.end() ? &it->second : &empty;
+    }
+
+    // Full name -> structural hash, of both classes and enums
+    std::unordered_map<std::string, uint64_t> GetStructuralHashes() const
+    {
+        std::unordered_map<std::string, uint64_t> hashes;
+        for (auto& [fullName, classMeta] : classes_) {
+            hashes[std::string(fullName)] = classMeta->structuralHash;
+        }
+        for (auto& [fullName, enumMeta] : enums_) {
+            hashes[std::string(fullName)] = enumMeta->structuralHash;
+        }
+        return hashes;
+    }
+
+    void MarkUnchangedEntities(const std::unordered_map<std::string, uint64_t>& previousHashes)
+    {
+        auto isUnchanged = [&previousHashes](std::string_view fullName, uint64_t hash) {
+            auto it = previousHashes.find(std::string(fullName));
+            return it != previousHashes.end() && it->second == hash;
+        };
+        for (auto& [fullName, classMeta] : classes_) {
+            classMeta->unchangedSinceLastRun = isUnchanged(fullName, classMeta->structuralHash);
+        }
+        for (auto& [fullName, enumMeta] : enums_) {
+            enumMeta->unchangedSinceLastRun = isUnchanged(fullName, enumMeta->structuralHash);
+        }
+    }
+
+    ClassMeta* GetOrCreateClassMetaInCurrentNamespace(const InternedString& className)
+    {
+        auto* ns = namespaceState.Current();
+        if (auto it = classes_.find(QualifiedName { ns, className.str() }); it != classes_.end()) {
+            return it->second;
+        }
+        auto* classMeta = arena_.New<ClassMeta>(arena_);
+        classMeta->SetName(className, ns, arena_);
+        classes_.emplace(classMeta->GetFullName(), classMeta);
+        classList_.push_back(classMeta);
+        return classMeta;
+    }
+
+    EnumMeta* GetOrCreateEnumMetaInCurrentNamespace(const InternedString& enumName)
+    {
+        auto* ns = namespaceState.Current();
+        if (auto it = enums_.find(QualifiedName { ns, enumName.str() }); it != enums_.end()) {
+            return it->second;
+        }
+        auto* enumMeta = arena_.New<EnumMeta>(arena_);
+        enumMeta->SetName(enumName, ns, arena_);
+        enums_.emplace(enumMeta->GetFullName(), enumMeta);
+        enumList_.push_back(enumMeta);
+        return enumMeta;
+    }
+
+private:
+    mutable std::unique_ptr<MetaTables> tables_ {};
+    mutable std::unique_ptr<FfiTables> ffiTables_ {};
+
+    template <typename T>
+    void IndexAnnotations(T* meta, std::vector<T*> AnnotatedEntities::*list)
+    {
+        for (auto& [key, value] : meta->annotationMap) {
+            (annotationIndex_[key].*list).push_back(meta);
+        }
+    }
 
-    std::shared_ptr<ClassMeta> GetOrCreateClassMetaInCurrentNamespace(const std::string& className)
+    static void HashBaseMeta(Hasher& hasher, const BaseMeta& meta)
     {
-        auto fullName = namespaceState.Current()->GetFullName() + "::" + className;
-        auto& ptr = classes_[fullName];
-        if (ptr == nullptr) {
-            ptr = std::make_shared<ClassMeta>();
-            ptr->name = className;
-            ptr->namespace_ = namespaceState.Current();
+        hasher.Update(meta.GetFullName()).Update(meta.type);
+        hasher.Update(uint64_t(meta.annotations.size()));
+        for (auto& annotation : meta.annotations) {
+            hasher.Update(annotation);
         }
-        return ptr;
     }
 
-    std::shared_ptr<EnumMeta> GetOrCreateEnumMetaInCurrentNamespace(const std::string& enumName)
+    static void HashNamedObjects(Hasher& hasher, const ArenaVector<NamedObject>& objects)
     {
-        auto fullName = namespaceState.Current()->GetFullName() + "::" + enumName;
-        auto& ptr = enums_[fullName];
-        if (ptr == nullptr) {
-            ptr = std::make_shared<EnumMeta>();
-            ptr->name = enumName;
-            ptr->namespace_ = namespaceState.Current();
+        hasher.Update(uint64_t(objects.size()));
+        for (auto& o : objects) {
+            hasher.Update(o.name).Update(o.type);
         }
-        return ptr;
     }
 };
\ No newline at end of file
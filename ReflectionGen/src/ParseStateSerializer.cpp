@@ -0,0 +1,318 @@
+#include "ParseStateSerializer.h"
+#include <unordered_map>
+#include <vector>
+
+static const char kMagic[4] = { 'R', 'G', 'P', 'S' };
+
+class BinaryWriter {
+public:
+    void WriteU64(uint64_t v)
+    {
+        while (v >= 0x80U) {
+            buffer_.push_back(char(v | 0x80U));
+            v >>= 7U;
+        }
+        buffer_.push_back(char(v));
+    }
+    void WriteBool(bool b) { buffer_.push_back(b ? 1 : 0); }
+    void WriteString(std::string_view s)
+    {
+        WriteU64(s.size());
+        buffer_.append(s.data(), s.size());
+    }
+    void WriteRaw(const char* data, size_t size) { buffer_.append(data, size); }
+
+    std::string& Buffer() { return buffer_; }
+
+private:
+    std::string buffer_ {};
+};
+
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data)
+        : data_ { data }
+    {
+    }
+    uint64_t ReadU64()
+    {
+        uint64_t v = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            if (pos_ >= data_.size()) {
+                ok_ = false;
+                return 0;
+            }
+            auto byte = uint8_t(data_[pos_++]);
+            v |= uint64_t(byte & 0x7FU) << shift;
+            if ((byte & 0x80U) == 0) {
+                return v;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+    bool ReadBool() { return ReadU64() != 0; }
+    std::string ReadString()
+    {
+        auto size = ReadU64();
+        if (!ok_ || size > data_.size() - pos_) {
+            ok_ = false;
+            return {};
+        }
+        std::string s { data_.substr(pos_, size) };
+        pos_ += size;
+        return s;
+    }
+    // Interned straight from the buffer, without building a std::string
+    InternedString ReadInterned()
+    {
+        auto size = ReadU64();
+        if (!ok_ || size > data_.size() - pos_) {
+            ok_ = false;
+            return {};
+        }
+        InternedString s { data_.substr(pos_, size) };
+        pos_ += size;
+        return s;
+    }
+    bool ReadRaw(char* out, size_t size)
+    {
+        if (size > data_.size() - pos_) {
+            ok_ = false;
+            return false;
+        }
+        data_.copy(out, size, pos_);
+        pos_ += size;
+        return true;
+    }
+    // Guards against allocating a huge vector for a corrupted count
+    uint64_t ReadCount()
+    {
+        auto count = ReadU64();
+        if (count > data_.size() - pos_) {
+            ok_ = false;
+            return 0;
+        }
+        return count;
+    }
+
+    void Fail() { ok_ = false; }
+    bool Ok() const { return ok_; }
+    bool AtEnd() const { return pos_ == data_.size(); }
+
+private:
+    std::string_view data_;
+    size_t pos_ { 0 };
+    bool ok_ { true };
+};
+
+static void WriteStrings(BinaryWriter& w, const ArenaVector<InternedString>& strings)
+{
+    w.WriteU64(strings.size());
+    for (auto& s : strings) {
+        w.WriteString(s);
+    }
+}
+
+static void ReadStrings(BinaryReader& r, std::vector<InternedString>& strings)
+{
+    auto count = r.ReadCount();
+    strings.reserve(count);
+    for (uint64_t i = 0; i < count && r.Ok(); ++i) {
+        strings.push_back(r.ReadInterned());
+    }
+}
+
+static void WriteNamedObjects(BinaryWriter& w, const ArenaVector<NamedObject>& objects)
+{
+    w.WriteU64(objects.size());
+    for (auto& o : objects) {
+        w.WriteString(o.name);
+        w.WriteString(o.type);
+    }
+}
+
+static void ReadNamedObjects(BinaryReader& r, ArenaVector<NamedObject>& objects)
+{
+    auto count = r.ReadCount();
+    objects.reserve(count);
+    for (uint64_t i = 0; i < count && r.Ok(); ++i) {
+        NamedObject o;
+        o.name = r.ReadInterned();
+        o.type = r.ReadInterned();
+        objects.push_back(std::move(o));
+    }
+}
+
+struct NamespaceIndexer {
+    std::unordered_map<const Namespace*, uint64_t> indices;
+    std::vector<const Namespace*> ordered;
+
+    // Pre-order, so that a parent is always written before its children
+    void Collect(const Namespace* ns)
+    {
+        indices[ns] = ordered.size();
+        ordered.push_back(ns);
+        for (auto& [name, child] : ns->children) {
+            Collect(child.get());
+        }
+    }
+};
+
+static void WriteBaseMeta(BinaryWriter& w, const BaseMeta& meta, const NamespaceIndexer& namespaces)
+{
+    w.WriteString(meta.name);
+    w.WriteString(meta.type);
+    WriteStrings(w, meta.annotations);
+    w.WriteU64(namespaces.indices.at(meta.namespace_));
+}
+
+static void ReadBaseMeta(BinaryReader& r, BaseMeta& meta, const std::vector<Namespace*>& namespaces, MetaArena& arena)
+{
+    auto name = r.ReadInterned();
+    meta.type = r.ReadInterned();
+    std::vector<InternedString> annotations;
+    ReadStrings(r, annotations);
+    meta.SetAnnotations(annotations);
+    auto nsIndex = r.ReadU64();
+    if (nsIndex >= namespaces.size()) {
+        meta.SetName(name, namespaces.front(), arena);
+        r.Fail();
+        return;
+    }
+    meta.SetName(name, namespaces[nsIndex], arena);
+}
+
+std::string ParseStateSerializer::Serialize(const ParseState& state)
+{
+    BinaryWriter w;
+    w.WriteRaw(kMagic, sizeof(kMagic));
+    w.WriteU64(kFormatVersion);
+
+    NamespaceIndexer namespaces;
+    namespaces.Collect(state.namespaceState.Root());
+    w.WriteU64(namespaces.ordered.size() - 1); // root excluded
+    for (size_t i = 1; i < namespaces.ordered.size(); ++i) {
+        auto* ns = namespaces.ordered[i];
+        w.WriteU64(namespaces.indices.at(ns->parent));
+        w.WriteString(ns->name);
+        w.WriteBool(ns->isStruct);
+    }
+
+    w.WriteU64(state.classList_.size());
+    for (auto& classMeta : state.classList_) {
+        WriteBaseMeta(w, *classMeta, namespaces);
+        w.WriteBool(classMeta->isAbstract);
+
+        w.WriteU64(classMeta->constructors.size());
+        for (auto& ctor : classMeta->constructors) {
+            WriteBaseMeta(w, *ctor, namespaces);
+            WriteNamedObjects(w, ctor->arguments);
+        }
+        w.WriteU64(classMeta->methods.size());
+        for (auto& method : classMeta->methods) {
+            WriteBaseMeta(w, *method, namespaces);
+            w.WriteBool(method->isStatic);
+            w.WriteString(method->returnType);
+            WriteNamedObjects(w, method->arguments);
+        }
+        w.WriteU64(classMeta->fields.size());
+        for (auto& field : classMeta->fields) {
+            WriteBaseMeta(w, *field, namespaces);
+            w.WriteBool(field->isStatic);
+        }
+    }
+
+    w.WriteU64(state.enumList_.size());
+    for (auto& enumMeta : state.enumList_) {
+        WriteBaseMeta(w, *enumMeta, namespaces);
+        w.WriteBool(enumMeta->isClass);
+        w.WriteString(enumMeta->underlyingType);
+        w.WriteU64(enumMeta->values.size());
+        for (auto& value : enumMeta->values) {
+            w.WriteString(value.name);
+            w.WriteString(value.value);
+        }
+    }
+    return std::move(w.Buffer());
+}
+
+bool ParseStateSerializer::Deserialize(std::string_view data, ParseState& state)
+{
+    BinaryReader r { data };
+    char magic[sizeof(kMagic)];
+    if (!r.ReadRaw(magic, sizeof(magic)) || std::string_view(magic, sizeof(magic)) != std::string_view(kMagic, sizeof(kMagic))) {
+        return false;
+    }
+    if (r.ReadU64() != kFormatVersion) {
+        return false;
+    }
+
+    std::vector<Namespace*> namespaces { state.namespaceState.Root() };
+    auto namespaceCount = r.ReadCount();
+    namespaces.reserve(namespaceCount + 1);
+    for (uint64_t i = 0; i < namespaceCount && r.Ok(); ++i) {
+        auto parentIndex = r.ReadU64();
+        auto name = r.ReadString();
+        auto isStruct = r.ReadBool();
+        if (parentIndex >= namespaces.size()) {
+            return false;
+        }
+        auto* parent = namespaces[parentIndex];
+        auto& child = parent->children[name];
+        child = std::make_shared<Namespace>(std::move(name), parent, isStruct);
+        namespaces.push_back(child.get());
+    }
+
+    auto classCount = r.ReadCount();
+    for (uint64_t i = 0; i < classCount && r.Ok(); ++i) {
+        auto* classMeta = state.arena_.New<ClassMeta>(state.arena_);
+        ReadBaseMeta(r, *classMeta, namespaces, state.arena_);
+        classMeta->isAbstract = r.ReadBool();
+
+        auto ctorCount = r.ReadCount();
+        for (uint64_t j = 0; j < ctorCount && r.Ok(); ++j) {
+            auto* ctor = state.arena_.New<ConstructorMeta>(state.arena_);
+            ReadBaseMeta(r, *ctor, namespaces, state.arena_);
+            ReadNamedObjects(r, ctor->arguments);
+            classMeta->constructors.push_back(ctor);
+        }
+        auto methodCount = r.ReadCount();
+        for (uint64_t j = 0; j < methodCount && r.Ok(); ++j) {
+            auto* method = state.arena_.New<MethodMeta>(state.arena_);
+            ReadBaseMeta(r, *method, namespaces, state.arena_);
+            method->isStatic = r.ReadBool();
+            method->returnType = r.ReadInterned();
+            ReadNamedObjects(r, method->arguments);
+            classMeta->methods.push_back(method);
+        }
+        auto fieldCount = r.ReadCount();
+        for (uint64_t j = 0; j < fieldCount && r.Ok(); ++j) {
+            auto* field = state.arena_.New<FieldMeta>(state.arena_);
+            ReadBaseMeta(r, *field, namespaces, state.arena_);
+            field->isStatic = r.ReadBool();
+            classMeta->fields.push_back(field);
+        }
+        state.classList_.push_back(classMeta);
+        state.classes_[classMeta->GetFullName()] = classMeta;
+    }
+
+    auto enumCount = r.ReadCount();
+    for (uint64_t i = 0; i < enumCount && r.Ok(); ++i) {
+        auto* enumMeta = state.arena_.New<EnumMeta>(state.arena_);
+        ReadBaseMeta(r, *enumMeta, namespaces, state.arena_);
+        enumMeta->isClass = r.ReadBool();
+        enumMeta->underlyingType = r.ReadInterned();
+        auto valueCount = r.ReadCount();
+        enumMeta->values.reserve(valueCount);
+        for (uint64_t j = 0; j < valueCount && r.Ok(); ++j) {
+            EnumValue value;
+            value.name = r.ReadInterned();
+            value.value = r.ReadInterned();
+            enumMeta->values.push_back(std::move(value));
+        }
+        state.enumList_.push_back(enumMeta);
+        state.enums_[enumMeta->GetFullName()] = enumMeta;
+    }
+    return r.Ok() && r.AtEnd();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Meta.h"
+#include "ParseState.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Binary (de)serialization of a ParseState, used to share parse results through the cache directory.
+class ParseStateSerializer {
+public:
+    ParseStateSerializer() = delete;
+
+    // Bump it whenever the layout changes, old cache entries will then never be looked up
+    static constexpr uint32_t kFormatVersion = 3;
+
+    static std::string Serialize(const ParseState& state);
+
+    static bool Deserialize(std::string_view data, ParseState& state);
+};
@@ -0,0 +1,258 @@
+#include "PlainSnapshot.h"
+#include "Hash.h"
+
+void PushAnnotationValue(lua_State* L, const AnnotationValue& value)
+{
+    switch (value.type) {
+    case AnnotationValue::Type::kBool:
+        lua_pushboolean(L, value.boolean);
+        break;
+    case AnnotationValue::Type::kInteger:
+        lua_pushinteger(L, lua_Integer(value.integer));
+        break;
+    case AnnotationValue::Type::kNumber:
+        lua_pushnumber(L, lua_Number(value.number));
+        break;
+    case AnnotationValue::Type::kString:
+        lua_pushlstring(L, value.string.c_str(), value.string.size());
+        break;
+    case AnnotationValue::Type::kList:
+        lua_createtable(L, int(value.list.size()), 0);
+        for (size_t i = 0; i < value.list.size(); ++i) {
+            PushAnnotationValue(L, value.list[i]);
+            lua_rawseti(L, -2, int(i + 1));
+        }
+        break;
+    }
+}
+
+namespace {
+
+// Absolute stack indices of the tables used while pushing
+struct Context {
+    lua_State* L;
+    int metaMetatable; // shared by all the metas, gives them GetFullName()
+    int lookup;        // meta pointer -> its table, to build the annotation index
+};
+
+void PushString(lua_State* L, std::string_view s)
+{
+    lua_pushlstring(L, s.data(), s.size());
+}
+
+void SetString(lua_State* L, const char* key, std::string_view s)
+{
+    PushString(L, s);
+    lua_setfield(L, -2, key);
+}
+
+void SetBool(lua_State* L, const char* key, bool b)
+{
+    lua_pushboolean(L, b);
+    lua_setfield(L, -2, key);
+}
+
+void SetNamedObjects(lua_State* L, const char* key, const ArenaVector<NamedObject>& objects)
+{
+    lua_createtable(L, int(objects.size()), 0);
+    for (size_t i = 0; i < objects.size(); ++i) {
+        lua_createtable(L, 0, 2);
+        SetString(L, "name", objects[i].name);
+        SetString(L, "type", objects[i].type);
+        lua_rawseti(L, -2, int(i + 1));
+    }
+    lua_setfield(L, -2, key);
+}
+
+void SetStructuralHash(lua_State* L, const StructuralHash& hash)
+{
+    SetString(L, "structuralHash", HashToHex(hash.structuralHash));
+    SetBool(L, "unchangedSinceLastRun", hash.unchangedSinceLastRun);
+}
+
+int GetFullName(lua_State* L)
+{
+    lua_getfield(L, 1, "fullName");
+    return 1;
+}
+
+void PushEmptyEntities(lua_State* L)
+{
+    lua_createtable(L, 0, 5);
+    for (auto* key : { "classes", "enums", "constructors", "methods", "fields" }) {
+        lua_createtable(L, 0, 0);
+        lua_setfield(L, -2, key);
+    }
+}
+
+int Find(lua_State* L)
+{
+    lua_getfield(L, 1, "annotationIndex");
+    lua_pushvalue(L, 2);
+    lua_rawget(L, -2);
+    if (lua_isnil(L, -1)) {
+        PushEmptyEntities(L);
+    }
+    return 1;
+}
+
+// A table { __index = { name = function } }
+void PushMethodsMetatable(lua_State* L, const char* name, lua_CFunction function)
+{
+    lua_createtable(L, 0, 1);
+    lua_createtable(L, 0, 1);
+    lua_pushcfunction(L, function);
+    lua_setfield(L, -2, name);
+    lua_setfield(L, -2, "__index");
+}
+
+// The table of a meta with the fields all of them have, extraFields is the count of the ones the caller adds
+void PushBaseMeta(const Context& ctx, const BaseMeta& meta, int extraFields)
+{
+    auto* L = ctx.L;
+    lua_createtable(L, 0, 6 + extraFields);
+    SetString(L, "name", meta.name);
+    SetString(L, "type", meta.type);
+    SetString(L, "fullName", meta.GetFullName());
+    lua_createtable(L, int(meta.annotations.size()), 0);
+    for (size_t i = 0; i < meta.annotations.size(); ++i) {
+        PushString(L, meta.annotations[i]);
+        lua_rawseti(L, -2, int(i + 1));
+    }
+    lua_setfield(L, -2, "annotations");
+    lua_createtable(L, 0, int(meta.annotationMap.size()));
+    for (auto& [key, value] : meta.annotationMap) {
+        PushString(L, key);
+        PushAnnotationValue(L, value);
+        lua_rawset(L, -3);
+    }
+    lua_setfield(L, -2, "annotationMap");
+    sol::stack::push(L, meta.namespace_);
+    lua_setfield(L, -2, "namespace");
+    lua_pushvalue(L, ctx.metaMetatable);
+    lua_setmetatable(L, -2);
+
+    lua_pushlightuserdata(L, const_cast<BaseMeta*>(&meta));
+    lua_pushvalue(L, -2);
+    lua_rawset(L, ctx.lookup);
+}
+
+template <typename T, typename PushMember>
+void SetMembers(const Context& ctx, const char* key, const ArenaVector<T*>& members, PushMember pushMember)
+{
+    lua_createtable(ctx.L, int(members.size()), 0);
+    for (size_t i = 0; i < members.size(); ++i) {
+        pushMember(ctx, *members[i]);
+        lua_rawseti(ctx.L, -2, int(i + 1));
+    }
+    lua_setfield(ctx.L, -2, key);
+}
+
+void PushClass(const Context& ctx, const ClassMeta& classMeta)
+{
+    auto* L = ctx.L;
+    PushBaseMeta(ctx, classMeta, 6);
+    SetBool(L, "isAbstract", classMeta.isAbstract);
+    SetStructuralHash(L, classMeta);
+    SetMembers(ctx, "constructors", classMeta.constructors, [](const Context& ctx, const ConstructorMeta& ctor) {
+        PushBaseMeta(ctx, ctor, 1);
+        SetNamedObjects(ctx.L, "arguments", ctor.arguments);
+    });
+    SetMembers(ctx, "methods", classMeta.methods, [](const Context& ctx, const MethodMeta& method) {
+        PushBaseMeta(ctx, method, 3);
+        SetBool(ctx.L, "isStatic", method.isStatic);
+        SetString(ctx.L, "returnType", method.returnType);
+        SetNamedObjects(ctx.L, "arguments", method.arguments);
+    });
+    SetMembers(ctx, "fields", classMeta.fields, [](const Context& ctx, const FieldMeta& field) {
+        PushBaseMeta(ctx, field, 1);
+        SetBool(ctx.L, "isStatic", field.isStatic);
+    });
+}
+
+void PushEnum(const Context& ctx, const EnumMeta& enumMeta)
+{
+    auto* L = ctx.L;
+    PushBaseMeta(ctx, enumMeta, 5);
+    SetBool(L, "isClass", enumMeta.isClass);
+    SetString(L, "underlyingType", enumMeta.underlyingType);
+    SetStructuralHash(L, enumMeta);
+    lua_createtable(L, int(enumMeta.values.size()), 0);
+    for (size_t i = 0; i < enumMeta.values.size(); ++i) {
+        lua_createtable(L, 0, 2);
+        SetString(L, "name", enumMeta.values[i].name);
+        SetString(L, "value", enumMeta.values[i].value);
+        lua_rawseti(L, -2, int(i + 1));
+    }
+    lua_setfield(L, -2, "values");
+}
+
+// Sets both the array in source order and the table by full name
+template <typename T, typename PushMeta>
+void SetMetas(const Context& ctx, int result, const char* listKey, const char* mapKey, const std::vector<T*>& metas, PushMeta pushMeta)
+{
+    auto* L = ctx.L;
+    lua_createtable(L, int(metas.size()), 0);
+    int list = lua_gettop(L);
+    lua_createtable(L, 0, int(metas.size()));
+    int map = lua_gettop(L);
+    for (size_t i = 0; i < metas.size(); ++i) {
+        pushMeta(ctx, *metas[i]);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, list, int(i + 1));
+        PushString(L, metas[i]->GetFullName());
+        lua_insert(L, -2);
+        lua_rawset(L, map);
+    }
+    lua_setfield(L, result, mapKey);
+    lua_setfield(L, result, listKey);
+}
+
+template <typename T>
+void SetIndexedMetas(const Context& ctx, const char* key, const std::vector<T*>& metas)
+{
+    lua_createtable(ctx.L, int(metas.size()), 0);
+    for (size_t i = 0; i < metas.size(); ++i) {
+        lua_pushlightuserdata(ctx.L, const_cast<BaseMeta*>(static_cast<const BaseMeta*>(metas[i])));
+        lua_rawget(ctx.L, ctx.lookup);
+        lua_rawseti(ctx.L, -2, int(i + 1));
+    }
+    lua_setfield(ctx.L, -2, key);
+}
+
+} // namespace
+
+void PlainSnapshot::Push(lua_State* L, const ParseState& state)
+{
+    luaL_checkstack(L, 32, "pushing the plain snapshot");
+    lua_createtable(L, 0, 7);
+    int result = lua_gettop(L);
+    PushMethodsMetatable(L, "GetFullName", GetFullName);
+    int metaMetatable = lua_gettop(L);
+    lua_createtable(L, 0, 0);
+    int lookup = lua_gettop(L);
+    Context ctx { L, metaMetatable, lookup };
+
+    SetMetas(ctx, result, "classList", "classes", state.classList_, PushClass);
+    SetMetas(ctx, result, "enumList", "enums", state.enumList_, PushEnum);
+
+    lua_createtable(L, 0, int(state.annotationIndex_.size()));
+    for (auto& [key, entities] : state.annotationIndex_) {
+        PushString(L, key);
+        lua_createtable(L, 0, 5);
+        SetIndexedMetas(ctx, "classes", entities.classes);
+        SetIndexedMetas(ctx, "enums", entities.enums);
+        SetIndexedMetas(ctx, "constructors", entities.constructors);
+        SetIndexedMetas(ctx, "methods", entities.methods);
+        SetIndexedMetas(ctx, "fields", entities.fields);
+        lua_rawset(L, -3);
+    }
+    lua_setfield(L, result, "annotationIndex");
+
+    sol::stack::push(L, &state);
+    lua_setfield(L, result, "source");
+
+    PushMethodsMetatable(L, "Find", Find);
+    lua_setmetatable(L, result);
+    lua_settop(L, result);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Annotation.h"
+#include "LuaKeepAlive.h"
+#include "ParseState.h"
+#include <sol/sol.hpp>
+
+// Pushes an annotation value as a native Lua value, flags are true and lists are arrays
+void PushAnnotationValue(lua_State* L, const AnnotationValue& value);
+
+// Converts a whole ParseState into native Lua tables in one pass, for scripts which access every member several
+// times: a field of a table is a plain lookup, while a usertype property or container index is a call into C++.
+// The tables have the same fields as the usertypes, containers become arrays/tables (so e.g. `#t == 0` instead of
+// `t:empty()`), and the metas keep their `GetFullName()` method. The result also has `Find(key)`, and `source`,
+// the ParseResult usertype it's made of, e.g. for `source:GetTables()`.
+class PlainSnapshot {
+public:
+    PlainSnapshot() = delete;
+
+    // Pushes the snapshot table onto the stack, BuildAnnotationIndex() must have been called
+    static void Push(lua_State* L, const ParseState& state);
+};
@@ -1,8 +1,22 @@
 #include "ReflectionGen.h"
+#include "FileUtils.h"
+#include "Hash.h"
+#include "IncrementalCache.h"
+#include "LuaAllocator.h"
+#include "LuaKeepAlive.h"
 #include "Meta.h"
+#include "NativePlugin.h"
+#include "OutputWriter.h"
+#include "ParseStateSerializer.h"
 #include "ParseTask.h"
+#include "PlainSnapshot.h"
 #include "ReflectionParser.h"
+#include "ScriptProfiler.h"
+#include "SharedStore.h"
+#include "StringBuilder.h"
 #include "StringUtils.h"
+#include "Template.h"
+#include "TypeRegistry.h"
 #include <algorithm>
 #include <chrono>
 #include <filesystem>
@@ -14,6 +28,109 @@
 
 static std::atomic_uint64_t gCurrentClassIndex { 0 };
 static std::mutex gScriptGlobalMutex {};
+static std::mutex gClassIdsMutex {};
+static std::unordered_map<uint64_t, std::string> gClassIds {}; // id -> salted full name, for collision detection
+// The parse results a work thread's Lua state may keep alive before it's collected, see LuaKeepAlive
+static const size_t kMaxKeptBytes = 64 * 1024 * 1024;
+
+// Interned strings are plain strings in Lua, which interns (short) strings on its own
+template <>
+struct sol::lua_type_of<InternedString> : std::integral_constant<sol::type, sol::type::string> { };
+
+template <typename Handler>
+static bool sol_lua_check(sol::types<InternedString>, lua_State* L, int index, Handler&& handler, sol::stack::record& tracking)
+{
+    return sol::stack::check<std::string_view>(L, index, std::forward<Handler>(handler), tracking);
+}
+
+static InternedString sol_lua_get(sol::types<InternedString>, lua_State* L, int index, sol::stack::record& tracking)
+{
+    return InternedString { sol::stack::get<std::string_view>(L, index, tracking) };
+}
+
+static int sol_lua_push(sol::types<InternedString>, lua_State* L, const InternedString& s)
+{
+    lua_pushlstring(L, s.c_str(), s.size());
+    return 1;
+}
+
+// An annotationMap is a userdata rather than one of sol's containers, see IndexAnnotationMap()
+template <>
+struct sol::is_container<AnnotationMap> : std::false_type { };
+template <>
+struct sol::is_automagical<AnnotationMap> : std::false_type { };
+
+// Annotation values are pushed as native Lua values, flags are true and lists are arrays. The table of a list is cached
+// with the ParseState of the map at index, so that every read of it doesn't build it again. It's shared by the reads
+static void PushAnnotationValue(lua_State* L, int index, const AnnotationValue& value)
+{
+    if (value.type != AnnotationValue::Type::kList || !LuaKeepAlive::PushCache(L, index)) {
+        PushAnnotationValue(L, value);
+        return;
+    }
+    lua_pushlightuserdata(L, const_cast<AnnotationValue*>(&value));
+    lua_rawget(L, -2);
+    if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        PushAnnotationValue(L, value);
+        lua_pushlightuserdata(L, const_cast<AnnotationValue*>(&value));
+        lua_pushvalue(L, -2);
+        lua_rawset(L, -4);
+    }
+    lua_remove(L, -2);
+}
+
+static const AnnotationMap::value_type* FindAnnotation(lua_State* L, const AnnotationMap& map, int index)
+{
+    if (lua_type(L, index) != LUA_TSTRING) {
+        return nullptr;
+    }
+    size_t size = 0;
+    const char* key = lua_tolstring(L, index, &size);
+    auto it = map.find(std::string_view(key, size));
+    return it != map.end() ? &*it : nullptr;
+}
+
+// annotationMap[key], nil if no annotation has the key, which isn't interned then
+static int IndexAnnotationMap(lua_State* L)
+{
+    auto& map = sol::stack::get<const AnnotationMap&>(L, 1);
+    auto* item = FindAnnotation(L, map, 2);
+    if (item == nullptr) {
+        lua_pushnil(L);
+    } else {
+        PushAnnotationValue(L, 1, item->second);
+    }
+    return 1;
+}
+
+static int NextAnnotation(lua_State* L)
+{
+    auto& map = sol::stack::get<const AnnotationMap&>(L, 1);
+    auto it = map.begin();
+    if (!lua_isnil(L, 2)) {
+        auto* item = FindAnnotation(L, map, 2);
+        if (item == nullptr) {
+            return luaL_error(L, "invalid key to 'next'");
+        }
+        it = std::next(map.find(item->first));
+    }
+    if (it == map.end()) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushlstring(L, it->first.c_str(), it->first.size());
+    PushAnnotationValue(L, 1, it->second);
+    return 2;
+}
+
+static int PairsAnnotationMap(lua_State* L)
+{
+    lua_pushcfunction(L, NextAnnotation);
+    lua_pushvalue(L, 1);
+    lua_pushnil(L);
+    return 3;
+}
 
 static inline uint64_t GetSteadyTimeMicros()
 {
@@ -21,7 +138,113 @@ static inline uint64_t GetSteadyTimeMicros()
     return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
 }
 
-static void BindScript(sol::state& lua)
+static bool IsInteger(const sol::object& number)
+{
+    number.push();
+#if LUA_VERSION_NUM >= 503
+    bool isInteger = lua_isinteger(number.lua_state(), -1);
+#else // LuaJIT, all the numbers are doubles
+    auto value = lua_tonumber(number.lua_state(), -1);
+    bool isInteger = value == lua_Number(int64_t(value));
+#endif
+    lua_pop(number.lua_state(), 1);
+    return isInteger;
+}
+
+// Only strings and numbers can be shared between the Lua states, integers are kept apart from floats
+static SharedValue ToSharedValue(const sol::object& object)
+{
+    if (object.get_type() == sol::type::string) {
+        return object.as<std::string>();
+    }
+    if (object.get_type() == sol::type::number) {
+        if (IsInteger(object)) {
+            return int64_t(object.as<lua_Integer>());
+        }
+        return object.as<double>();
+    }
+    throw std::runtime_error(std::string("Only strings and numbers can be shared, got a ") + sol::type_name(object.lua_state(), object.get_type()));
+}
+
+static sol::object FromSharedValue(lua_State* L, const SharedValue& value)
+{
+    return std::visit([L](const auto& v) { return sol::make_object(L, v); }, value);
+}
+
+static StringBuilder& ToStringBuilder(const sol::userdata& self)
+{
+    if (!self.is<StringBuilder>()) {
+        throw std::runtime_error("StringBuilder method called on another object");
+    }
+    return self.as<StringBuilder&>();
+}
+
+// Appends a string, number or StringBuilder as `..` would, without making a Lua string
+static void AppendLuaValue(StringBuilder& sb, const sol::object& value)
+{
+    switch (value.get_type()) {
+    case sol::type::string:
+        sb.Append(value.as<std::string_view>());
+        break;
+    case sol::type::number:
+        if (IsInteger(value)) {
+            sb.AppendInteger(value.as<lua_Integer>());
+        } else {
+            sb.AppendNumber(value.as<double>());
+        }
+        break;
+    default:
+        if (value.is<StringBuilder>()) {
+            sb.Append(value.as<const StringBuilder&>().View());
+            break;
+        }
+        throw std::runtime_error(std::string("attempt to append a ") + sol::type_name(value.lua_state(), value.get_type()) + " value");
+    }
+}
+
+// Anything but a string or a number goes through %s as its name, like tostring() would for nil and booleans
+static FormatArgument ToFormatArgument(const sol::object& value)
+{
+    switch (value.get_type()) {
+    case sol::type::string:
+        return value.as<std::string_view>();
+    case sol::type::number:
+        if (IsInteger(value)) {
+            return int64_t(value.as<lua_Integer>());
+        }
+        return value.as<double>();
+    case sol::type::boolean:
+        return std::string_view(value.as<bool>() ? "true" : "false");
+    case sol::type::lua_nil:
+        return std::string_view("nil");
+    default:
+        if (value.is<StringBuilder>()) {
+            return value.as<const StringBuilder&>().View();
+        }
+        throw std::runtime_error(std::string("can't format a ") + sol::type_name(value.lua_state(), value.get_type()) + " value");
+    }
+}
+
+static void RenderTemplate(const Template& tpl, const sol::object& object, StringBuilder& sb)
+{
+    if (object.is<ClassMeta>()) {
+        tpl.Render(object.as<const ClassMeta&>(), sb);
+    } else if (object.is<EnumMeta>()) {
+        tpl.Render(object.as<const EnumMeta&>(), sb);
+    } else if (object.is<ParseState>()) {
+        tpl.Render(object.as<const ParseState&>(), sb);
+    } else if (object.is<MethodMeta>()) {
+        tpl.Render(object.as<const MethodMeta&>(), sb);
+    } else if (object.is<ConstructorMeta>()) {
+        tpl.Render(object.as<const ConstructorMeta&>(), sb);
+    } else if (object.is<FieldMeta>()) {
+        tpl.Render(object.as<const FieldMeta&>(), sb);
+    } else {
+        throw std::runtime_error("Render expects a meta or a ParseResult usertype");
+    }
+}
+
+static void BindScript(sol::state& lua, TypeRegistry& registry, SharedStore& store)
 {
     lua.open_libraries(sol::lib::base, sol::lib::package, sol::lib::coroutine,
         sol::lib::string, sol::lib::os, sol::lib::math, sol::lib::table,
@@ -54,10 +277,14 @@ static void BindScript(sol::state& lua)
         "value", &EnumValue::value
         //
     );
+    auto structuralHashToHex = [](const StructuralHash& meta) { return HashToHex(meta.structuralHash); };
     refGen.new_usertype<ClassMeta>("ClassMeta",
         "isAbstract", &ClassMeta::isAbstract,
+        "structuralHash", sol::property(structuralHashToHex),
+        "unchangedSinceLastRun", &ClassMeta::unchangedSinceLastRun,
         "name", &ClassMeta::name,
         "annotations", &ClassMeta::annotations,
+        "annotationMap", sol::readonly(&ClassMeta::annotationMap),
         "namespace", &ClassMeta::namespace_,
         "constructors", &ClassMeta::constructors,
         "methods", &ClassMeta::methods,
@@ -69,6 +296,7 @@ static void BindScript(sol::state& lua)
         "name", &FieldMeta::name,
         "type", &FieldMeta::type,
         "annotations", &FieldMeta::annotations,
+        "annotationMap", sol::readonly(&FieldMeta::annotationMap),
         "namespace", &FieldMeta::namespace_,
         "isStatic", &FieldMeta::isStatic,
         "GetFullName", &FieldMeta::GetFullName
@@ -78,6 +306,7 @@ static void BindScript(sol::state& lua)
         "name", &ConstructorMeta::name,
         "type", &ConstructorMeta::type,
         "annotations", &ConstructorMeta::annotations,
+        "annotationMap", sol::readonly(&ConstructorMeta::annotationMap),
         "namespace", &ConstructorMeta::namespace_,
         "arguments", &ConstructorMeta::arguments,
         "GetFullName", &ConstructorMeta::GetFullName
@@ -87,6 +316,7 @@ static void BindScript(sol::state& lua)
         "name", &MethodMeta::name,
         "type", &MethodMeta::type,
         "annotations", &MethodMeta::annotations,
+        "annotationMap", sol::readonly(&MethodMeta::annotationMap),
         "namespace", &MethodMeta::namespace_,
         "isStatic", &MethodMeta::isStatic,
         "returnType", &MethodMeta::returnType,
@@ -98,23 +328,256 @@ static void BindScript(sol::state& lua)
         "name", &EnumMeta::name,
         "type", &EnumMeta::type,
         "annotations", &EnumMeta::annotations,
+        "annotationMap", sol::readonly(&EnumMeta::annotationMap),
         "namespace", &EnumMeta::namespace_,
         "isClass", &EnumMeta::isClass,
         "underlyingType", &EnumMeta::underlyingType,
+        "structuralHash", sol::property(structuralHashToHex),
+        "unchangedSinceLastRun", &EnumMeta::unchangedSinceLastRun,
         "values", &EnumMeta::values,
         "GetFullName", &EnumMeta::GetFullName
         //
     );
+    refGen.new_usertype<AnnotationMap>("AnnotationMap", sol::no_constructor,
+        sol::meta_function::index, &IndexAnnotationMap,
+        sol::meta_function::pairs, &PairsAnnotationMap
+        //
+    );
+    refGen.new_usertype<AnnotatedEntities>("AnnotatedEntities",
+        "classes", sol::readonly(&AnnotatedEntities::classes),
+        "enums", sol::readonly(&AnnotatedEntities::enums),
+        "constructors", sol::readonly(&AnnotatedEntities::constructors),
+        "methods", sol::readonly(&AnnotatedEntities::methods),
+        "fields", sol::readonly(&AnnotatedEntities::fields)
+        //
+    );
+    // Columnar tables and their row views, the script side indices are 1 based
+    refGen.new_usertype<FieldTable>("FieldTable",
+        "size", sol::property(&FieldTable::Size),
+        "name", sol::readonly(&FieldTable::name),
+        "type", sol::readonly(&FieldTable::type)
+        //
+    );
+    refGen.new_usertype<MethodTable>("MethodTable",
+        "size", sol::property(&MethodTable::Size),
+        "name", sol::readonly(&MethodTable::name),
+        "type", sol::readonly(&MethodTable::type),
+        "returnType", sol::readonly(&MethodTable::returnType)
+        //
+    );
+    refGen.new_usertype<ArgumentTable>("ArgumentTable",
+        "size", sol::property(&ArgumentTable::Size),
+        "name", sol::readonly(&ArgumentTable::name),
+        "type", sol::readonly(&ArgumentTable::type)
+        //
+    );
+    refGen.new_usertype<EnumValueTable>("EnumValueTable",
+        "size", sol::property(&EnumValueTable::Size),
+        "name", sol::readonly(&EnumValueTable::name),
+        "value", sol::readonly(&EnumValueTable::value)
+        //
+    );
+    refGen.new_usertype<FieldView>("FieldView",
+        "name", sol::property(&FieldView::Name),
+        "type", sol::property(&FieldView::Type),
+        "isStatic", sol::property(&FieldView::IsStatic),
+        "owner", sol::property(&FieldView::Owner)
+        //
+    );
+    refGen.new_usertype<ArgumentView>("ArgumentView",
+        "name", sol::property(&ArgumentView::Name),
+        "type", sol::property(&ArgumentView::Type)
+        //
+    );
+    refGen.new_usertype<MethodView>("MethodView",
+        "name", sol::property(&MethodView::Name),
+        "type", sol::property(&MethodView::Type),
+        "returnType", sol::property(&MethodView::ReturnType),
+        "isStatic", sol::property(&MethodView::IsStatic),
+        "isConstructor", sol::property(&MethodView::IsConstructor),
+        "owner", sol::property(&MethodView::Owner),
+        "argumentCount", sol::property(&MethodView::ArgumentCount),
+        "Argument", [](const MethodView& view, uint32_t i) { return view.Argument(i - 1); }
+        //
+    );
+    refGen.new_usertype<EnumValueView>("EnumValueView",
+        "name", sol::property(&EnumValueView::Name),
+        "value", sol::property(&EnumValueView::Value),
+        "owner", sol::property(&EnumValueView::Owner)
+        //
+    );
+    refGen.new_usertype<MetaTables>("MetaTables",
+        "fields", sol::readonly(&MetaTables::fields),
+        "methods", sol::readonly(&MetaTables::methods),
+        "arguments", sol::readonly(&MetaTables::arguments),
+        "enumValues", sol::readonly(&MetaTables::enumValues),
+        "Field", [](const MetaTables& tables, uint32_t i) { return tables.Field(i - 1); },
+        "Method", [](const MetaTables& tables, uint32_t i) { return tables.Method(i - 1); },
+        "Argument", [](const MetaTables& tables, uint32_t i) { return tables.Argument(i - 1); },
+        "EnumValue", [](const MetaTables& tables, uint32_t i) { return tables.EnumValue(i - 1); }
+        //
+    );
     refGen.new_usertype<ParseState>("ParseResult",
         "classes", &ParseState::classes_,
-        "enums", &ParseState::enums_
+        "enums", &ParseState::enums_,
+        "classList", &ParseState::classList_,
+        "enumList", &ParseState::enumList_,
+        "Find", &ParseState::Find,
+        "GetTables", &ParseState::GetTables
+        //
+    );
+    // Enums have no members, classes no values. A record replaced in the registry frees its ParseState, so what's got
+    // from one is owned by it too
+    static const ArenaVector<ConstructorMeta*> kNoConstructors {};
+    static const ArenaVector<MethodMeta*> kNoMethods {};
+    static const ArenaVector<FieldMeta*> kNoFields {};
+    static const ArenaVector<EnumValue> kNoValues {};
+    refGen.new_usertype<TypeRecord>("TypeRecord",
+        "kind", sol::property([](const TypeRecord& record) { return record.classMeta != nullptr ? "class" : "enum"; }),
+        "name", sol::property([](const TypeRecord& record) { return record.GetMeta().name; }),
+        "fullName", sol::property([](const TypeRecord& record) { return record.GetMeta().GetFullName(); }),
+        "file", sol::readonly(&TypeRecord::file),
+        "structuralHash", sol::property([](const TypeRecord& record) {
+            return HashToHex(record.classMeta != nullptr ? record.classMeta->structuralHash : record.enumMeta->structuralHash);
+        }),
+        "annotations", sol::property([](const TypeRecord& record, sol::this_state L) {
+            LuaKeepAlive::Capture(L, record.source);
+            return &record.GetMeta().annotations;
+        }),
+        "annotationMap", sol::property([](const TypeRecord& record, sol::this_state L) {
+            LuaKeepAlive::Capture(L, record.source);
+            return &record.GetMeta().annotationMap;
+        }),
+        "isAbstract", sol::property([](const TypeRecord& record) { return record.classMeta != nullptr && record.classMeta->isAbstract; }),
+        "constructors", sol::property([](const TypeRecord& record, sol::this_state L) {
+            LuaKeepAlive::Capture(L, record.source);
+            return record.classMeta != nullptr ? &record.classMeta->constructors : &kNoConstructors;
+        }),
+        "fields", sol::property([](const TypeRecord& record, sol::this_state L) {
+            LuaKeepAlive::Capture(L, record.source);
+            return record.classMeta != nullptr ? &record.classMeta->fields : &kNoFields;
+        }),
+        "methods", sol::property([](const TypeRecord& record, sol::this_state L) {
+            LuaKeepAlive::Capture(L, record.source);
+            return record.classMeta != nullptr ? &record.classMeta->methods : &kNoMethods;
+        }),
+        "isClass", sol::property([](const TypeRecord& record) { return record.enumMeta != nullptr && record.enumMeta->isClass; }),
+        "underlyingType", sol::property([](const TypeRecord& record) {
+            return record.enumMeta != nullptr ? record.enumMeta->underlyingType : InternedString {};
+        }),
+        "values", sol::property([](const TypeRecord& record, sol::this_state L) {
+            LuaKeepAlive::Capture(L, record.source);
+            return record.enumMeta != nullptr ? &record.enumMeta->values : &kNoValues;
+        })
+        //
+    );
+    auto typeRegistry = lua["TypeRegistry"].get_or_create<sol::table>();
+    auto checkEnabled = [&registry]() {
+        if (!registry.IsEnabled()) {
+            throw std::runtime_error("the type registry is disabled, set 'ReflectionGenConfig.TypeRegistry = true'");
+        }
+    };
+    typeRegistry["Find"] = [&registry, checkEnabled](const std::string& fullName) {
+        checkEnabled();
+        return registry.Find(fullName);
+    };
+    typeRegistry["Size"] = [&registry, checkEnabled]() {
+        checkEnabled();
+        return registry.Size();
+    };
+    typeRegistry["GetAll"] = [&registry, checkEnabled]() {
+        checkEnabled();
+        return sol::as_table(registry.GetAll());
+    };
+#if REFLECTION_GEN_LUAJIT
+    // Zero-copy access for LuaJIT: ReflectionGen.GetFfiTables(parseResult) returns a 'const RgTables*' cdata
+    refGen["GetFfiTablesPointer"] = [](const ParseState& state) {
+        return sol::lightuserdata_value(const_cast<RgTables*>(state.GetFfiTables()->Get()));
+    };
+    sol::protected_function bindFfi = lua.load(R"(
+        local ffi = require("ffi")
+        ffi.cdef(...)
+        local tablesType = ffi.typeof("const RgTables*")
+        ReflectionGen.GetFfiTables = function(parseResult)
+            return ffi.cast(tablesType, ReflectionGen.GetFfiTablesPointer(parseResult))
+        end
+        ReflectionGen.FfiString = function(s)
+            return ffi.string(s.data, s.size)
+        end
+    )");
+    bindFfi(kFfiCdef);
+#endif
+    // The methods return the builder itself, rather than a reference which would not keep it alive, so that calls
+    // can be chained, e.g. StringBuilder.new():SetIndentUnit('\t')
+    refGen.new_usertype<StringBuilder>("StringBuilder",
+        sol::constructors<StringBuilder()>(),
+        "Append", [](const sol::userdata& self, sol::variadic_args args) {
+            auto& sb = ToStringBuilder(self);
+            for (auto arg : args) {
+                AppendLuaValue(sb, arg);
+            }
+            return self;
+        },
+        "Appendf", [](const sol::userdata& self, std::string_view format, sol::variadic_args args) {
+            std::vector<FormatArgument> formatArgs;
+            formatArgs.reserve(args.size());
+            for (auto arg : args) {
+                formatArgs.push_back(ToFormatArgument(arg));
+            }
+            ToStringBuilder(self).AppendFormat(format, formatArgs);
+            return self;
+        },
+        "Join", [](const sol::userdata& self, const sol::table& items, sol::optional<std::string_view> separator) {
+            auto& sb = ToStringBuilder(self);
+            for (size_t i = 1; i <= items.size(); ++i) {
+                if (i > 1 && separator.has_value()) {
+                    sb.Append(separator.value());
+                }
+                AppendLuaValue(sb, items.get<sol::object>(i));
+            }
+            return self;
+        },
+        "Indent", [](const sol::userdata& self, sol::optional<int> delta) {
+            ToStringBuilder(self).Indent(delta.value_or(1));
+            return self;
+        },
+        "SetIndentUnit", [](const sol::userdata& self, std::string_view unit) {
+            ToStringBuilder(self).SetIndentUnit(unit);
+            return self;
+        },
+        "Reserve", &StringBuilder::Reserve,
+        "Clear", &StringBuilder::Clear,
+        "Size", &StringBuilder::Size,
+        "ToString", &StringBuilder::ToString,
+        sol::meta_function::to_string, &StringBuilder::ToString,
+        sol::meta_function::length, &StringBuilder::Size
+        //
+    );
+    // tpl:Render(meta, sb) appends to sb and returns it, tpl:Render(meta) returns a string
+    refGen.new_usertype<Template>("Template",
+        sol::no_constructor,
+        "Render", [](const Template& tpl, const sol::object& object, const sol::object& sb, sol::this_state s) {
+            if (sb.is<StringBuilder>()) {
+                RenderTemplate(tpl, object, sb.as<StringBuilder&>());
+                return sb;
+            }
+            StringBuilder local {};
+            RenderTemplate(tpl, object, local);
+            return sol::make_object(s, local.ToString());
+        }
         //
     );
+    auto templates = lua["Template"].get_or_create<sol::table>();
+    templates["Compile"] = [](std::string_view source) { return Template::Compile(source); };
     auto fileUtils = lua["FileUtils"].get_or_create<sol::table>();
     fileUtils["MakeDirsForFile"] = [](const std::string& filePath) {
-        std::filesystem::path p(filePath);
-        p = p.parent_path();
-        std::filesystem::create_directories(p);
+        if (!FileUtils::MakeDirsForFile(filePath)) {
+            throw std::runtime_error("failed to create the directories of '" + filePath + "'");
+        }
+    };
+    fileUtils["WriteFile"] = [](const std::string& filePath, const sol::object& content) { // a string or a StringBuilder
+        auto data = content.is<StringBuilder>() ? content.as<const StringBuilder&>().View() : content.as<std::string_view>();
+        return FileUtils::WriteFile(filePath, data);
     };
     auto miscUtils = lua["MiscUtils"].get_or_create<sol::table>();
     miscUtils["NextClassId"] = []() { // Used to generating class id
@@ -122,13 +585,61 @@ static void BindScript(sol::state& lua)
         // Thus we take the high 12 bits as an atomic counter, and the rest 52 bits as timestamp,
         // this will make a unique ID, even you run this program multiple times,
         // unless you generate more than 4095 IDs in one us or run multiple instances of this program simultaneously.
+        // NOTE: the generated code then differs on every run, prefer ClassId if it matters.
         auto id = (gCurrentClassIndex.fetch_add(1) << 52U) | GetSteadyTimeMicros();
         return std::to_string(id); //
     };
-    miscUtils["DoExclusively"] = [](const std::function<void()>& job) {
+    miscUtils["ClassId"] = [](const std::string& fullName, sol::optional<std::string> salt) {
+        // Derived from the full name only, so it's the same across runs, which keeps the generated code byte-identical
+        std::string key = salt.has_value() ? salt.value() + '\0' + fullName : fullName;
+        auto id = HashString(key);
+        {
+            std::unique_lock<std::mutex> lck(gClassIdsMutex);
+            auto [it, inserted] = gClassIds.emplace(id, key);
+            if (!inserted && it->second != key) {
+                throw std::runtime_error("Class id collision between '" + fullName + "' and '"
+                    + it->second.substr(it->second.find('\0') + 1) + "', try another salt");
+            }
+        }
+        return std::to_string(id);
+    };
+    miscUtils["DoExclusively"] = [](const std::function<void()>& job) { // Prefer SharedStore, this serializes all the threads
         std::unique_lock<std::mutex> lck(gScriptGlobalMutex);
         job();
     };
+    auto sharedStore = lua["SharedStore"].get_or_create<sol::table>();
+    sharedStore["Increment"] = [&store](const std::string& counter, sol::optional<int64_t> delta) {
+        return store.Increment(counter, delta.value_or(1));
+    };
+    sharedStore["GetCounter"] = [&store](const std::string& counter) { return store.GetCounter(counter); };
+    sharedStore["Append"] = [&store](const std::string& list, const sol::object& value) {
+        return store.Append(list, ToSharedValue(value));
+    };
+    sharedStore["GetList"] = [&store](const std::string& list, sol::this_state s) {
+        auto values = store.GetList(list);
+        auto table = sol::state_view(s).create_table(int(values.size()), 0);
+        for (size_t i = 0; i < values.size(); ++i) {
+            table[i + 1] = FromSharedValue(s, values[i]);
+        }
+        return table;
+    };
+    sharedStore["Set"] = [&store](const std::string& map, const std::string& key, const sol::object& value) {
+        store.Set(map, key, ToSharedValue(value));
+    };
+    sharedStore["Get"] = [&store](const std::string& map, const std::string& key, sol::this_state s) {
+        auto value = store.Get(map, key);
+        return value.has_value() ? FromSharedValue(s, value.value()) : sol::make_object(s, sol::lua_nil);
+    };
+    // An array of { key = ..., value = ... } sorted by key, rather than a table iterated in hash order
+    sharedStore["GetMap"] = [&store](const std::string& map, sol::this_state s) {
+        auto entries = store.GetMap(map);
+        sol::state_view lua(s);
+        auto table = lua.create_table(int(entries.size()), 0);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            table[i + 1] = lua.create_table_with("key", entries[i].first, "value", FromSharedValue(s, entries[i].second));
+        }
+        return table;
+    };
 }
 
 static int DoScript(sol::state& lua, const std::string& scriptPath)
@@ -175,6 +686,154 @@ static bool GetCompilerOptions(sol::state& lua, std::vector<std::string>& result
     return true;
 }
 
+// The files the outputs depend on besides the script: the modules it required while it was loaded, found again with
+// package.searchpath, and those listed in 'ReflectionGenConfig.Dependencies', e.g. the templates it reads
+static bool GetScriptDependencies(sol::state& lua, std::vector<std::string>& result)
+{
+    result.clear();
+    auto dependencies = lua["ReflectionGenConfig"]["Dependencies"];
+    if (dependencies.valid()) {
+        auto table = dependencies.get<sol::optional<sol::table>>();
+        if (!table.has_value()) {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.Dependencies' should be an array of string" << std::endl;
+            return false;
+        }
+        for (auto& kv : table.value()) {
+            auto opt = kv.second.as<sol::optional<std::string>>();
+            if (!opt.has_value()) {
+                std::cerr << "Failed to parse config: 'ReflectionGenConfig.Dependencies' should be an array of string" << std::endl;
+                return false;
+            }
+            result.push_back(opt.value());
+        }
+    }
+    sol::protected_function searchPath = lua["package"]["searchpath"];
+    auto path = lua["package"]["path"].get_or<std::string>("");
+    sol::table loaded = lua["package"]["loaded"];
+    for (auto& kv : loaded) {
+        auto name = kv.first.as<sol::optional<std::string>>();
+        if (!name.has_value()) {
+            continue;
+        }
+        // The built-in libraries aren't found
+        sol::protected_function_result found = searchPath(name.value(), path);
+        if (found.valid()) {
+            if (auto file = found.get<sol::optional<std::string>>(); file.has_value()) {
+                result.push_back(file.value());
+            }
+        }
+    }
+    // package.loaded iterates in hash order
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return true;
+}
+
+enum class GcMode {
+    kIncremental,
+    kGenerational,
+    // The collector is stopped while a task runs, and a full collection is done after it
+    kBetweenTasks,
+};
+
+// Optional switches in 'ReflectionGenConfig' which change how the script is called
+struct ScriptOptions {
+    // Don't call 'OnFileParsed' for the files without any annotated entity
+    bool skipFilesWithoutAnnotations { false };
+    // 'ReflectionGenCallback.OnFileParsed' is defined, it's optional when there are native plugins
+    bool hasFileParsedCallback { false };
+    // 'ReflectionGenCallback.OnAllFilesParsed' is defined, the type registry is built for it
+    bool hasAllFilesParsedCallback { false };
+    // Pass the parse results as native Lua tables instead of usertypes, see PlainSnapshot
+    bool plainTables { false };
+    // The scripts use the 'TypeRegistry' table
+    bool typeRegistry { false };
+    // 'ReflectionGenCallback.OnFilesParsed' is defined, it's called instead of 'OnFileParsed' with several files at once
+    bool hasFilesParsedCallback { false };
+    // The most files passed to one 'OnFilesParsed' call
+    size_t filesPerBatch { 32 };
+#if LUA_VERSION_NUM >= 504
+    GcMode gcMode { GcMode::kGenerational };
+#else
+    GcMode gcMode { GcMode::kIncremental };
+#endif
+    // With kBetweenTasks, only collect once the Lua state uses more than this, 0 means after every task
+    size_t gcWatermark { 0 };
+};
+
+static bool GetScriptOptions(sol::state& lua, ScriptOptions& options)
+{
+    auto skip = lua["ReflectionGenConfig"]["SkipFilesWithoutAnnotations"];
+    if (skip.valid()) {
+        auto opt = skip.get<sol::optional<bool>>();
+        if (!opt.has_value()) {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.SkipFilesWithoutAnnotations' should be a boolean" << std::endl;
+            return false;
+        }
+        options.skipFilesWithoutAnnotations = opt.value();
+    }
+    auto plainTables = lua["ReflectionGenConfig"]["PlainTables"];
+    if (plainTables.valid()) {
+        auto opt = plainTables.get<sol::optional<bool>>();
+        if (!opt.has_value()) {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.PlainTables' should be a boolean" << std::endl;
+            return false;
+        }
+        options.plainTables = opt.value();
+    }
+    auto typeRegistry = lua["ReflectionGenConfig"]["TypeRegistry"];
+    if (typeRegistry.valid()) {
+        auto opt = typeRegistry.get<sol::optional<bool>>();
+        if (!opt.has_value()) {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.TypeRegistry' should be a boolean" << std::endl;
+            return false;
+        }
+        options.typeRegistry = opt.value();
+    }
+    auto filesPerBatch = lua["ReflectionGenConfig"]["FilesPerBatch"];
+    if (filesPerBatch.valid()) {
+        auto opt = filesPerBatch.get<sol::optional<int64_t>>();
+        if (!opt.has_value() || opt.value() < 1) {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.FilesPerBatch' should be a positive integer" << std::endl;
+            return false;
+        }
+        options.filesPerBatch = size_t(opt.value());
+    }
+    auto gcMode = lua["ReflectionGenConfig"]["GarbageCollector"];
+    if (gcMode.valid()) {
+        auto opt = gcMode.get<sol::optional<std::string>>();
+        if (opt == "incremental") {
+            options.gcMode = GcMode::kIncremental;
+#if LUA_VERSION_NUM >= 504
+        } else if (opt == "generational") {
+            options.gcMode = GcMode::kGenerational;
+#endif
+        } else if (opt == "between-tasks") {
+            options.gcMode = GcMode::kBetweenTasks;
+        } else {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.GarbageCollector' should be one of "
+#if LUA_VERSION_NUM >= 504
+                      << "'generational', "
+#endif
+                      << "'incremental' or 'between-tasks'" << std::endl;
+            return false;
+        }
+    }
+    auto gcWatermark = lua["ReflectionGenConfig"]["GcWatermarkMB"];
+    if (gcWatermark.valid()) {
+        auto opt = gcWatermark.get<sol::optional<int64_t>>();
+        if (!opt.has_value() || opt.value() < 0) {
+            std::cerr << "Failed to parse config: 'ReflectionGenConfig.GcWatermarkMB' should be a non negative integer" << std::endl;
+            return false;
+        }
+        options.gcWatermark = size_t(opt.value()) * 1024 * 1024;
+    }
+    options.hasFileParsedCallback = lua["ReflectionGenCallback"]["OnFileParsed"].get_type() == sol::type::function;
+    options.hasAllFilesParsedCallback = lua["ReflectionGenCallback"]["OnAllFilesParsed"].get_type() == sol::type::function;
+    options.hasFilesParsedCallback = lua["ReflectionGenCallback"]["OnFilesParsed"].get_type() == sol::type::function;
+    return true;
+}
+
 static void AddCompilerArgs(std::vector<const char*>& dst, const std::vector<std::string>& newArgs)
 {
     for (auto& s : newArgs) {
@@ -200,24 +859,80 @@ static void AddCompilerArgs(std::vector<const char*>& dst, const std::vector<con
 std::atomic_int gWorkThreadIdCounter { 0 };
 class WorkThread {
 public:
-    explicit WorkThread(const ReflectionGenConfig& config, ParseTaskQueue& taskQueue)
+    // The full collections done by the work thread itself, see GcMode::kBetweenTasks
+    struct GcStats {
+        size_t collections { 0 };
+        std::chrono::steady_clock::duration time {};
+    };
+
+    explicit WorkThread(const ReflectionGenConfig& config, ParseTaskQueue& taskQueue, IncrementalCache* cache, TypeRegistry& registry, SharedStore& store,
+        const std::vector<std::unique_ptr<NativePlugin>>& plugins)
         : config_ { config }
         , threadId_ { gWorkThreadIdCounter++ }
         , taskQueue_ { taskQueue }
+        , cache_ { cache }
+        , registry_ { registry }
+        , store_ { store }
+        , plugins_ { plugins }
     {
     }
     ~WorkThread()
+    {
+        Join();
+        for (size_t i = 0; i < pluginContexts_.size(); ++i) {
+            if (plugins_[i]->Get().DestroyContext != nullptr) {
+                plugins_[i]->Get().DestroyContext(pluginContexts_[i]);
+            }
+        }
+    }
+
+    void Join()
     {
         if (thread_.joinable()) {
             thread_.join();
         }
     }
 
+    // Called on the main thread once all the work threads are joined, with the whole program collected from the type
+    // registry
+    int InvokeAllFilesParsedCallback()
+    {
+        if (!needsAllFiles_) {
+            return 0;
+        }
+        auto merged = std::make_shared<ParseState>();
+        registry_.CollectAll(*merged);
+        merged->BuildAnnotationIndex();
+        // There's no task after it, the collector has to run during it
+        if (scriptOptions_.gcMode == GcMode::kBetweenTasks) {
+            lua_gc(lua_, LUA_GCRESTART, 0);
+        }
+        if (scriptOptions_.hasAllFilesParsedCallback && 0 != InvokeScript(onAllFilesParsed_, "OnAllFilesParsed", ToScriptResult(merged))) {
+            return 1;
+        }
+        for (size_t i = 0; i < plugins_.size(); ++i) {
+            auto* onAllFilesParsed = plugins_[i]->Get().OnAllFilesParsed;
+            if (onAllFilesParsed != nullptr && 0 != onAllFilesParsed(pluginContexts_[i], merged->GetFfiTables()->Get())) {
+                std::cerr << "Plugin " << plugins_[i]->GetPath() << " failed in OnAllFilesParsed" << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
     bool Initialize()
     {
-        BindScript(lua_);
+        BindScript(lua_, registry_, store_);
 
-        if (0 != DoScript(lua_, config_.scriptFile)) {
+        if (!config_.profileScript.empty()) {
+            profiler_ = std::make_unique<ScriptProfiler>(lua_);
+            profiler_->Start("script loading");
+        }
+        int loaded = DoScript(lua_, config_.scriptFile);
+        if (profiler_ != nullptr) {
+            profiler_->Stop();
+        }
+        if (0 != loaded) {
             return false;
         }
 
@@ -225,6 +940,31 @@ public:
             return false;
         }
 
+        if (!GetScriptOptions(lua_, scriptOptions_)) {
+            return false;
+        }
+        if (!GetScriptDependencies(lua_, scriptDependencies_)) {
+            return false;
+        }
+        ApplyGcMode();
+        sol::table callbacks = lua_["ReflectionGenCallback"];
+        if (callbacks.valid()) {
+            onFileParsed_ = callbacks["OnFileParsed"];
+            onFilesParsed_ = callbacks["OnFilesParsed"];
+            onAllFilesParsed_ = callbacks["OnAllFilesParsed"];
+        }
+        if (!CreatePluginContexts()) {
+            return false;
+        }
+        bool pluginsNeedAllFiles = std::any_of(plugins_.begin(), plugins_.end(), [](auto& plugin) {
+            return plugin->Get().OnAllFilesParsed != nullptr;
+        });
+        needsAllFiles_ = scriptOptions_.hasAllFilesParsedCallback || pluginsNeedAllFiles;
+        needsRegistry_ = needsAllFiles_ || scriptOptions_.typeRegistry;
+        if (needsRegistry_) {
+            registry_.Enable();
+        }
+
         isThreadRunning_ = true;
         thread_ = std::thread([this]() {
             ThreadRoutine();
@@ -233,12 +973,253 @@ public:
         return true;
     }
 
+    const GcStats& GetGcStats() const { return gcStats_; }
+    const ScriptProfiler* GetProfiler() const { return profiler_.get(); }
+#if !REFLECTION_GEN_LUAJIT
+    const LuaAllocator::Stats& GetAllocatorStats() const { return luaAllocator_.GetStats(); }
+#endif
+
 private:
+    void ApplyGcMode()
+    {
+        switch (scriptOptions_.gcMode) {
+        case GcMode::kIncremental:
+            break;
+        case GcMode::kGenerational:
+#if LUA_VERSION_NUM >= 504
+            lua_gc(lua_, LUA_GCGEN, 0, 0);
+#endif
+            break;
+        case GcMode::kBetweenTasks:
+            lua_gc(lua_, LUA_GCSTOP, 0);
+            break;
+        }
+    }
+
+    // The garbage of the tasks is collected at once, while no script runs. The parse results its userdata keep alive
+    // count too, whatever the mode: the collector doesn't see their memory, it wouldn't hurry to free them
+    void CollectBetweenTasks()
+    {
+        auto kept = LuaKeepAlive::GetKeptBytes(lua_);
+        if (scriptOptions_.gcMode != GcMode::kBetweenTasks && kept < kMaxKeptBytes) {
+            return;
+        }
+        auto used = size_t(lua_gc(lua_, LUA_GCCOUNT, 0)) * 1024 + kept;
+        if (used < scriptOptions_.gcWatermark && kept < kMaxKeptBytes) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        lua_gc(lua_, LUA_GCCOLLECT, 0);
+        gcStats_.time += std::chrono::steady_clock::now() - start;
+        ++gcStats_.collections;
+    }
+
+    bool CreatePluginContexts()
+    {
+        for (auto& plugin : plugins_) {
+            void* context = nullptr;
+            if (plugin->Get().CreateContext != nullptr && 0 != plugin->Get().CreateContext(NativePlugin::GetHost(), &context)) {
+                std::cerr << "Plugin " << plugin->GetPath() << " failed to create its context" << std::endl;
+                return false;
+            }
+            pluginContexts_.push_back(context);
+        }
+        return true;
+    }
+
+    int InvokePlugins(const ParseState& result, const ParseTask* task)
+    {
+        if (plugins_.empty()) {
+            return 0;
+        }
+        RgTask rgTask {
+            { task->inputFile.data(), task->inputFile.size() },
+            { task->outputFile.data(), task->outputFile.size() },
+            config_.scriptParams.data(),
+            uint32_t(config_.scriptParams.size()),
+        };
+        for (size_t i = 0; i < plugins_.size(); ++i) {
+            auto* onFileParsed = plugins_[i]->Get().OnFileParsed;
+            if (onFileParsed != nullptr && 0 != onFileParsed(pluginContexts_[i], result.GetFfiTables()->Get(), &rgTask)) {
+                std::cerr << "Plugin " << plugins_[i]->GetPath() << " failed to generate " << task->inputFile << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // A file on its way to the script, with what the cache needs once it's done
+    struct PendingFile {
+        std::shared_ptr<ParseState> result; // shared with the type registry
+        ParseTask* task;
+        uint64_t taskEnvHash;
+        uint64_t resultKey;
+        std::unordered_map<std::string, uint64_t> structuralHashes;
+        std::vector<std::string> outputs; // the files written for it
+    };
+
+    // Everything but the input files which affects the parse result
+    static uint64_t CalculateParseEnvHash(const std::vector<const char*>& compilerArgs)
+    {
+        Hasher hasher {};
+        for (auto* arg : compilerArgs) {
+            hasher.Update(std::string_view(arg));
+        }
+        return hasher.Digest();
+    }
+
+    // Everything but the parse result which affects the generated files
+    uint64_t CalculateEnvHash() const
+    {
+        Hasher hasher {};
+        for (auto* param : config_.scriptParams) {
+            hasher.Update(std::string_view(param));
+        }
+        uint64_t scriptHash {};
+        IncrementalCache::HashFileContent(config_.scriptFile, scriptHash);
+        hasher.Update(scriptHash);
+        for (auto& dependency : scriptDependencies_) {
+            uint64_t dependencyHash {}; // 0 if missing
+            IncrementalCache::HashFileContent(dependency, dependencyHash);
+            hasher.Update(dependency).Update(dependencyHash);
+        }
+        for (auto& plugin : plugins_) {
+            uint64_t pluginHash {};
+            IncrementalCache::HashFileContent(plugin->GetPath(), pluginHash);
+            hasher.Update(pluginHash);
+        }
+        return hasher.Digest();
+    }
+
+    // What the callbacks get for a parse result, the usertype or its plain table snapshot. The script may keep it after
+    // the task, see LuaKeepAlive
+    sol::object ToScriptResult(const std::shared_ptr<ParseState>& result)
+    {
+        LuaKeepAlive::Scope scope { lua_, result };
+        if (!scriptOptions_.plainTables) {
+            return sol::make_object(lua_, result.get());
+        }
+        PlainSnapshot::Push(lua_, *result);
+        sol::object snapshot(lua_, -1);
+        lua_pop(lua_, 1);
+        return snapshot;
+    }
+
+    // Calls one of the callbacks resolved by Initialize(), and reports its error if any
+    template <typename... Args>
+    int InvokeScript(const sol::protected_function& callback, const char* name, Args&&... args)
+    {
+        if (profiler_ != nullptr) {
+            profiler_->Start(name);
+        }
+        auto pr = callback(std::forward<Args>(args)...);
+        if (profiler_ != nullptr) {
+            profiler_->Stop();
+        }
+        if (pr.valid()) {
+            return 0;
+        } else {
+            sol::error err = pr;
+            std::cout << "Failed to callback '" << name << "'"
+                      << ": " << err.what();
+            return 1;
+        }
+    }
+
+    // Passes the pending files to 'OnFilesParsed' as an array of { result = ..., task = ... }, they are all marked as
+    // generated or failed together
+    void FlushPendingFiles()
+    {
+        if (pendingFiles_.empty()) {
+            return;
+        }
+        auto batch = lua_.create_table(int(pendingFiles_.size()), 0);
+        std::vector<std::string> inputFiles;
+        for (size_t i = 0; i < pendingFiles_.size(); ++i) {
+            batch[i + 1] = lua_.create_table_with("result", ToScriptResult(pendingFiles_[i].result), "task", pendingFiles_[i].task);
+            inputFiles.push_back(pendingFiles_[i].task->inputFile);
+        }
+        OutputWriter::SetCurrentInputFiles(std::move(inputFiles));
+        int ret = InvokeScript(onFilesParsed_, "OnFilesParsed", batch);
+        // Which file of the batch a file was written for isn't known, it's recorded for all of them
+        for (auto& file : pendingFiles_) {
+            file.outputs.insert(file.outputs.end(), writtenFiles_.begin(), writtenFiles_.end());
+        }
+        writtenFiles_.clear();
+        for (auto& file : pendingFiles_) {
+            FinishFile(file, ret);
+        }
+        pendingFiles_.clear();
+    }
+
+    void FinishFile(PendingFile& file, int ret)
+    {
+        if (ret != 0) {
+            std::cerr << "Failed to parse " << file.task->inputFile << std::endl;
+        }
+        if (cache_ != nullptr) {
+            if (ret == 0 && file.resultKey != 0) {
+                cache_->MarkGenerated(file.task->inputFile, file.taskEnvHash, file.resultKey, std::move(file.structuralHashes), file.outputs);
+            } else {
+                cache_->Invalidate(file.task->inputFile);
+            }
+        }
+    }
+
+    // The files which are not generated again still make up the program 'OnAllFilesParsed' sees
+    bool RegisterCachedResult(const std::string& codeFile, uint64_t resultKey)
+    {
+        std::string data;
+        auto cachedState = std::make_shared<ParseState>();
+        if (!cache_->LoadParseResult(resultKey, data) || !ParseStateSerializer::Deserialize(data, *cachedState)) {
+            return false;
+        }
+        cachedState->ComputeStructuralHashes();
+        registry_.Merge(cachedState, codeFile);
+        return true;
+    }
+
+    // With 'OnFilesParsed', the file is only added to the batch and deferred is set, FinishFile() is then up to the batch
+    int GenerateForResult(PendingFile& file, bool& deferred)
+    {
+        auto& result = *file.result;
+        auto* task = file.task;
+        OutputWriter::SetCurrentInputFiles({ task->inputFile });
+        result.ComputeStructuralHashes();
+        if (cache_ != nullptr) {
+            result.MarkUnchangedEntities(cache_->GetPreviousStructuralHashes(task->inputFile, file.taskEnvHash));
+        }
+        // Other threads can read the metas from now on
+        if (needsRegistry_) {
+            registry_.Merge(file.result, task->inputFile);
+        }
+        file.structuralHashes = result.GetStructuralHashes();
+        if (scriptOptions_.skipFilesWithoutAnnotations && !result.HasAnnotatedEntities()) {
+            return 0;
+        }
+        if (0 != InvokePlugins(result, task)) {
+            return 1;
+        }
+        result.BuildAnnotationIndex();
+        if (scriptOptions_.hasFilesParsedCallback) {
+            deferred = true;
+            return 0;
+        }
+        // The plugins may be the only generators, the script then only gives the options
+        if (!scriptOptions_.hasFileParsedCallback && !plugins_.empty()) {
+            return 0;
+        }
+        return InvokeScript(onFileParsed_, "OnFileParsed", ToScriptResult(file.result), task);
+    }
+
     void ThreadRoutine()
     {
+        FileUtils::RecordWrittenFiles(&writtenFiles_);
         std::vector<const char*> compilerArgs;
         AddCompilerArgs(compilerArgs, compilerArgsFromLua_);
         AddCompilerArgs(compilerArgs, config_.clangParams);
+        uint64_t parseEnvHash = CalculateParseEnvHash(compilerArgs);
+        uint64_t envHash = cache_ != nullptr ? CalculateEnvHash() : 0;
 
         if (config_.debug) {
             std::stringstream ss;
@@ -256,44 +1237,112 @@ private:
                 break;
             }
             const std::string& codeFile = task->inputFile;
-            ReflectionParser parser { codeFile };
-
-            if (!parser.Initialize(compilerArgs)) {
-                ret = -1;
-                goto END;
+            uint64_t taskEnvHash = Hasher { envHash }.Update(task->outputFile).Digest();
+            PendingFile file { nullptr, task, taskEnvHash, 0, {}, {} };
+            uint64_t& resultKey = file.resultKey;
+            bool deferred = false;
+            bool withoutAnnotations = false;
+            if (cache_ != nullptr && cache_->FindParseResult(codeFile, parseEnvHash, resultKey, withoutAnnotations)) {
+                if (cache_->IsGenerated(codeFile, taskEnvHash, resultKey)
+                    && (!needsRegistry_ || RegisterCachedResult(codeFile, resultKey))) {
+                    if (config_.debug) {
+                        std::cout << "Skip up to date file " << codeFile << std::endl;
+                    }
+                    continue;
+                }
+                if (scriptOptions_.skipFilesWithoutAnnotations && withoutAnnotations
+                    && (!needsRegistry_ || RegisterCachedResult(codeFile, resultKey))) {
+                    if (config_.debug) {
+                        std::cout << "Skip file without annotations " << codeFile << std::endl;
+                    }
+                    goto END;
+                }
+                std::string data;
+                auto cachedState = std::make_unique<ParseState>();
+                if (cache_->LoadParseResult(resultKey, data) && ParseStateSerializer::Deserialize(data, *cachedState)) {
+                    if (config_.debug) {
+                        std::cout << "Reuse cached parse result for " << codeFile << std::endl;
+                    }
+                    file.result = std::move(cachedState);
+                    ret = GenerateForResult(file, deferred);
+                    goto END;
+                }
             }
 
-            if (!parser.Parse()) {
-                ret = -2;
-                goto END;
-            }
+            {
+                ReflectionParser parser { codeFile };
+
+                if (!parser.Initialize(compilerArgs)) {
+                    ret = -1;
+                    goto END;
+                }
+
+                if (!parser.Parse()) {
+                    ret = -2;
+                    goto END;
+                }
 
-            ret = parser.TraverseClasses([this, &task](const ParseState& result) {
-                auto pr = lua_["ReflectionGenCallback"]["OnFileParsed"](result, task);
-                if (pr.valid()) {
-                    return 0;
-                } else {
-                    sol::error err = pr;
-                    std::cout << "Failed to callback 'OnFileParsed'"
-                              << ": " << err.what();
-                    return 1;
+                auto& result = parser.GetParseState();
+                if (cache_ != nullptr) {
+                    resultKey = cache_->StoreParseResult(codeFile, parseEnvHash, parser.GetIncludedFiles(),
+                        ParseStateSerializer::Serialize(result), !result.HasAnnotatedEntities());
                 }
-            });
+                file.result = parser.TakeParseState();
+                ret = GenerateForResult(file, deferred);
+            }
         END:
-            if (ret != 0) {
-                std::cerr << "Failed to parse " << codeFile << std::endl;
+            file.outputs = std::move(writtenFiles_);
+            writtenFiles_.clear();
+            if (deferred) {
+                pendingFiles_.push_back(std::move(file));
+                if (pendingFiles_.size() >= scriptOptions_.filesPerBatch) {
+                    FlushPendingFiles();
+                    CollectBetweenTasks();
+                }
+                continue;
             }
+            FinishFile(file, ret);
+            CollectBetweenTasks();
         }
+        FlushPendingFiles();
+        CollectBetweenTasks();
+        FileUtils::RecordWrittenFiles(nullptr);
     }
 
 private:
     const ReflectionGenConfig& config_;
     int threadId_ {};
     ParseTaskQueue& taskQueue_;
+    IncrementalCache* cache_ {};
+    TypeRegistry& registry_;
+    SharedStore& store_;
+    const std::vector<std::unique_ptr<NativePlugin>>& plugins_;
+    std::vector<void*> pluginContexts_ {}; // one per plugin
     std::thread thread_ {};
     std::atomic_bool isThreadRunning_ { false };
+#if REFLECTION_GEN_LUAJIT
+    // 64 bit LuaJIT can't use a custom allocator
     sol::state lua_ {};
+#else
+    LuaAllocator luaAllocator_ {};
+    sol::state lua_ { sol::default_at_panic, &LuaAllocator::Allocate, &luaAllocator_ };
+#endif
+    GcStats gcStats_ {};
+    std::unique_ptr<ScriptProfiler> profiler_ {};
     std::vector<std::string> compilerArgsFromLua_ {};
+    // Hashed with the script, see GetScriptDependencies()
+    std::vector<std::string> scriptDependencies_ {};
+    ScriptOptions scriptOptions_ {};
+    // Resolved once, instead of looking them up by name for every file
+    sol::protected_function onFileParsed_ {};
+    sol::protected_function onFilesParsed_ {};
+    sol::protected_function onAllFilesParsed_ {};
+    std::vector<PendingFile> pendingFiles_ {};
+    // The files written by the script and the plugins for the current file or batch
+    std::vector<std::string> writtenFiles_ {};
+    // 'OnAllFilesParsed' is defined by the script or a plugin, which is given the whole program from the registry
+    bool needsAllFiles_ { false };
+    bool needsRegistry_ { false };
 };
 
 struct FilterContext {
@@ -359,6 +1408,33 @@ static void PopulateParseTaskVectorDirs(std::vector<ParseTask>& parseTask, const
     };
 }
 
+static void PrintGcStats(const std::vector<std::unique_ptr<WorkThread>>& workThreads)
+{
+    WorkThread::GcStats gcStats {};
+    for (auto& t : workThreads) {
+        gcStats.collections += t->GetGcStats().collections;
+        gcStats.time += t->GetGcStats().time;
+    }
+    std::cout << "Lua GC: " << gcStats.collections << " full collections between tasks in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(gcStats.time).count() / 1000.0 << " ms";
+#if !REFLECTION_GEN_LUAJIT
+    LuaAllocator::Stats allocatorStats {};
+    for (auto& t : workThreads) {
+        auto& stats = t->GetAllocatorStats();
+        allocatorStats.allocations += stats.allocations;
+        allocatorStats.pooledAllocations += stats.pooledAllocations;
+        allocatorStats.peakBytesInUse += stats.peakBytesInUse;
+        allocatorStats.chunkBytes += stats.chunkBytes;
+    }
+    std::cout << ", " << allocatorStats.allocations << " allocations (" << allocatorStats.pooledAllocations << " pooled), "
+              << allocatorStats.peakBytesInUse / 1024 << " KB peak, " << allocatorStats.chunkBytes / 1024 << " KB of pool chunks";
+#endif
+    std::cout << std::endl;
+}
+
+// Bounds the memory held by the files waiting to be written
+static const size_t kMaxQueuedOutputBytes = 256 * 1024 * 1024;
+
 int ReflectionGen::Run()
 {
     if (!CheckPaths()) {
@@ -376,18 +1452,51 @@ int ReflectionGen::Run()
     }
     auto workThreadsCount = config_.workThreadsCount;
 
+    std::unique_ptr<IncrementalCache> cache;
+    if (!config_.cacheDir.empty()) {
+        // Invocations with different scripts or output directories share the parse results, but not the manifest
+        auto targetId = Hasher {}
+                            .Update(IncrementalCache::NormalizePath(config_.scriptFile))
+                            .Update(IncrementalCache::NormalizePath(config_.outputDir))
+                            .Update(IncrementalCache::NormalizePath(config_.relativeDir))
+                            .Digest();
+        cache = std::make_unique<IncrementalCache>(config_.cacheDir, HashToHex(targetId), config_.cacheMaxSize);
+        if (!cache->Load()) {
+            return 2;
+        }
+    }
+
     ParseTaskQueue taskQueue(workThreadsCount * 2);
+    TypeRegistry registry {};
+    SharedStore store {};
+
+    // Loaded before the work threads, which destroy their contexts when they're destroyed
+    std::vector<std::unique_ptr<NativePlugin>> plugins;
+    for (auto& path : config_.plugins) {
+        plugins.push_back(std::make_unique<NativePlugin>());
+        if (!plugins.back()->Load(path)) {
+            return 2;
+        }
+    }
 
     std::vector<std::unique_ptr<WorkThread>> workThreads;
     workThreads.resize(workThreadsCount);
     for (auto& t : workThreads) {
-        t = std::make_unique<WorkThread>(config_, taskQueue);
+        t = std::make_unique<WorkThread>(config_, taskQueue, cache.get(), registry, store, plugins);
         if (!t->Initialize()) {
             std::cerr << "Failed to initialize work thread" << std::endl;
             return 2;
         }
     }
 
+    // From now on the files are queued, until the work threads are destroyed. What the scripts write while they're
+    // loaded is written synchronously
+    std::unique_ptr<OutputWriter> outputWriter;
+    if (config_.writeThreadsCount > 0) {
+        outputWriter = std::make_unique<OutputWriter>(config_.writeThreadsCount, kMaxQueuedOutputBytes);
+        FileUtils::SetOutputWriter(outputWriter.get());
+    }
+
     int retCode = 0;
     std::filesystem::path relativeDir(config_.relativeDir);
     std::error_code ec;
@@ -409,6 +1518,60 @@ int ReflectionGen::Run()
     for (uint32_t i = 0; i < workThreadsCount; ++i) {
         taskQueue.Push(nullptr); // to notify the work thread exit
     }
+    for (auto& t : workThreads) {
+        t->Join();
+    }
+    if (retCode == 0 && !workThreads.empty()) {
+        retCode = workThreads.front()->InvokeAllFilesParsedCallback();
+    }
+    if (config_.debug || config_.gcStats) {
+        PrintGcStats(workThreads);
+    }
+    if (!config_.profileScript.empty()) {
+        ScriptProfiler::Stacks stacks;
+        for (auto& t : workThreads) {
+            t->GetProfiler()->MergeInto(stacks);
+        }
+        if (!ScriptProfiler::Write(config_.profileScript, stacks)) {
+            retCode = 1;
+        }
+    }
+    workThreads.clear();
+
+    if (outputWriter != nullptr) {
+        FileUtils::SetOutputWriter(nullptr);
+        if (!outputWriter->Finish()) {
+            // The files were marked as generated once queued, only those whose outputs failed are generated again
+            retCode = 1;
+            if (cache != nullptr) {
+                for (auto& inputFile : outputWriter->GetFailedInputFiles()) {
+                    cache->Invalidate(inputFile);
+                }
+            }
+        }
+        if (config_.debug) {
+            auto& stats = outputWriter->GetStats();
+            std::cout << "Output: " << stats.written << " written, " << stats.unchanged << " unchanged, "
+                      << stats.failed << " failed" << std::endl;
+        }
+    }
+
+    if (cache != nullptr) {
+        if (!cache->Save()) {
+            retCode = 1;
+        }
+        if (config_.debug || config_.cacheStats) {
+            auto& stats = cache->GetStats();
+            auto& storeStats = cache->GetStoreStats();
+            std::cout << "Cache: " << stats.upToDate << " up to date, "
+                      << stats.parseHits << " parse result hits, " << stats.parseMisses << " parse result misses, "
+                      << stats.withoutAnnotations << " without annotations, "
+                      << stats.filesStated << " files stated, " << stats.filesHashed << " files hashed\n"
+                      << "Cache store: " << storeStats.hits << " hits, " << storeStats.misses << " misses, "
+                      << storeStats.stores << " stores, " << storeStats.evictedEntries << " evicted ("
+                      << storeStats.evictedBytes << " bytes)" << std::endl;
+        }
+    }
 
     return retCode;
 }
@@ -11,8 +11,18 @@ struct ReflectionGenConfig {
     std::string outputDir {};
     std::string relativeDir {};
     uint32_t workThreadsCount {};
+    // Threads writing the generated files, 0 to write them synchronously from the work threads
+    uint32_t writeThreadsCount {};
     std::vector<const char*> clangParams {};
     std::vector<const char*> scriptParams {};
+    std::string cacheDir {};
+    uint64_t cacheMaxSize {};
+    bool cacheStats { false };
+    bool gcStats { false };
+    // The file to write the collapsed stacks of the scripts to, empty if not profiled
+    std::string profileScript {};
+    // Shared libraries of native generators, see ReflectionGenPlugin.h
+    std::vector<std::string> plugins {};
     bool debug { false };
 };
 
@@ -1,5 +1,6 @@
 #include "ReflectionParser.h"
 #include "StringConvert.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
@@ -55,6 +56,24 @@ bool ReflectionParser::Parse()
                this);
 }
 
+std::vector<std::string> ReflectionParser::GetIncludedFiles() const
+{
+    std::vector<std::string> files;
+    if (translationUnit_ == nullptr) {
+        return files;
+    }
+    clang_getInclusions(
+        translationUnit_, [](CXFile includedFile, CXSourceLocation*, unsigned, CXClientData d) {
+            auto* files = reinterpret_cast<std::vector<std::string>*>(d);
+            files->push_back(toStdString(clang_getFileName(includedFile)));
+        },
+        &files);
+    // A header can be included multiple times if it has no include guard
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
 #define ClangVisitChildren(cursor, callback)                         \
     [this](CXCursor c) {                                             \
         return clang_visitChildren(                                  \
@@ -75,12 +94,12 @@ CXChildVisitResult ReflectionParser::VisitNamespace(CXCursor c, CXCursor parent)
     auto kind = clang_getCursorKind(c);
     switch (kind) {
     case CXCursor_Namespace: {
-        parseState_.namespaceState.EnterChild(toStdString(clang_getCursorSpelling(c)));
+        parseState_->namespaceState.EnterChild(toStdString(clang_getCursorSpelling(c)));
         if (0 != ClangVisitChildren(c, VisitNamespace)) {
-            parseState_.namespaceState.LeaveChild();
+            parseState_->namespaceState.LeaveChild();
             return CXChildVisit_Break;
         }
-        parseState_.namespaceState.LeaveChild();
+        parseState_->namespaceState.LeaveChild();
         return CXChildVisit_Continue;
     }
     case CXCursor_StructDecl:
@@ -98,8 +117,8 @@ CXChildVisitResult ReflectionParser::VisitNamespace(CXCursor c, CXCursor parent)
 
 CXChildVisitResult ReflectionParser::VisitClass(CXCursor c, CXCursor parent)
 {
-    auto name = GetClangCursorSpelling(c);
-    auto classMeta = parseState_.GetOrCreateClassMetaInCurrentNamespace(name);
+    auto name = GetClangCursorSpellingInterned(c);
+    auto* classMeta = parseState_->GetOrCreateClassMetaInCurrentNamespace(name);
     classMeta->isAbstract = clang_CXXRecord_isAbstract(c);
 
     struct Context {
@@ -108,11 +127,11 @@ CXChildVisitResult ReflectionParser::VisitClass(CXCursor c, CXCursor parent)
         ReflectionParser* self;
     };
     Context context {
-        classMeta.get(),
-        &parseState_,
+        classMeta,
+        parseState_.get(),
         this,
     };
-    parseState_.namespaceState.EnterChild(name);
+    parseState_->namespaceState.EnterChild(name);
     auto ret = clang_visitChildren(
         c, [](CXCursor c1, CXCursor p1, CXClientData d) {
             auto* ctx = reinterpret_cast<Context*>(d);
@@ -138,7 +157,7 @@ CXChildVisitResult ReflectionParser::VisitClass(CXCursor c, CXCursor parent)
 
             case CXCursor_AnnotateAttr: {
                 assert(ctx->classMeta->annotations.empty());
-                ctx->classMeta->annotations = AnnotationsToVector(toStdString(clang_getCursorSpelling(c1)));
+                ctx->classMeta->SetAnnotations(AnnotationsToVector(clang_getCursorSpelling(c1)));
                 return CXChildVisit_Continue;
             }
             default:
@@ -148,7 +167,7 @@ CXChildVisitResult ReflectionParser::VisitClass(CXCursor c, CXCursor parent)
         },
         &context);
 
-    parseState_.namespaceState.LeaveChild();
+    parseState_->namespaceState.LeaveChild();
     return ret == 0 ? CXChildVisit_Continue : CXChildVisit_Break;
 }
 
@@ -156,24 +175,23 @@ CXChildVisitResult ReflectionParser::VisitConstructor(CXCursor cursor, CXCursor
 {
     auto type = clang_getCursorType(cursor);
 
-    auto constructorMeta = std::make_shared<ConstructorMeta>();
+    auto* constructorMeta = parseState_->arena_.New<ConstructorMeta>(parseState_->arena_);
     owner->constructors.push_back(constructorMeta);
 
     {
-        constructorMeta->name = toStdString(clang_getCursorSpelling(cursor));
-        constructorMeta->type = toStdString(clang_getTypeSpelling(type));
-        constructorMeta->namespace_ = parseState_.namespaceState.Current();
+        constructorMeta->SetName(toInterned(clang_getCursorSpelling(cursor)), parseState_->namespaceState.Current(), parseState_->arena_);
+        constructorMeta->type = toInterned(clang_getTypeSpelling(type));
 
         int numArgs = clang_Cursor_getNumArguments(cursor);
         for (int i = 0; i < numArgs; ++i) {
             auto argCursor = clang_Cursor_getArgument(cursor, i);
             NamedObject arg;
-            arg.name = toStdString(clang_getCursorSpelling(argCursor));
+            arg.name = toInterned(clang_getCursorSpelling(argCursor));
             if (arg.name.empty()) {
                 arg.name = "[unnamed]";
             }
             auto arg_type = clang_getArgType(type, i);
-            arg.type = toStdString(arg_type);
+            arg.type = toInterned(arg_type);
             constructorMeta->arguments.push_back(arg);
         }
     }
@@ -183,8 +201,8 @@ CXChildVisitResult ReflectionParser::VisitConstructor(CXCursor cursor, CXCursor
         ParseState* state;
     };
     Context context {
-        constructorMeta.get(),
-        &parseState_,
+        constructorMeta,
+        parseState_.get(),
     };
     auto ret = clang_visitChildren(
         cursor, [](CXCursor c1, CXCursor p1, CXClientData d) {
@@ -195,7 +213,7 @@ CXChildVisitResult ReflectionParser::VisitConstructor(CXCursor cursor, CXCursor
             switch (kind) {
             case CXCursor_AnnotateAttr: {
                 assert(ctx->constructorMeta->annotations.empty());
-                ctx->constructorMeta->annotations = AnnotationsToVector(toStdString(clang_getCursorSpelling(c1)));
+                ctx->constructorMeta->SetAnnotations(AnnotationsToVector(clang_getCursorSpelling(c1)));
                 break;
             }
             default:
@@ -209,10 +227,9 @@ CXChildVisitResult ReflectionParser::VisitConstructor(CXCursor cursor, CXCursor
 
 CXChildVisitResult ReflectionParser::VisitField(CXCursor c, CXCursor parent, ClassMeta* owner, bool isStatic)
 {
-    auto fieldMeta = std::make_shared<FieldMeta>();
-    fieldMeta->name = GetClangCursorSpelling(c);
+    auto* fieldMeta = parseState_->arena_.New<FieldMeta>(parseState_->arena_);
+    fieldMeta->SetName(GetClangCursorSpellingInterned(c), parseState_->namespaceState.Current(), parseState_->arena_);
     fieldMeta->type = GetClangCursorTypeSpelling(c);
-    fieldMeta->namespace_ = parseState_.namespaceState.Current();
     fieldMeta->isStatic = isStatic;
 
     owner->fields.push_back(fieldMeta);
@@ -222,8 +239,8 @@ CXChildVisitResult ReflectionParser::VisitField(CXCursor c, CXCursor parent, Cla
         ParseState* state;
     };
     Context context {
-        fieldMeta.get(),
-        &parseState_,
+        fieldMeta,
+        parseState_.get(),
     };
     auto ret = clang_visitChildren(
         c, [](CXCursor c1, CXCursor p1, CXClientData d) {
@@ -233,7 +250,7 @@ CXChildVisitResult ReflectionParser::VisitField(CXCursor c, CXCursor parent, Cla
             switch (kind) {
             case CXCursor_AnnotateAttr: {
                 assert(ctx->fieldMeta->annotations.empty());
-                ctx->fieldMeta->annotations = AnnotationsToVector(GetClangCursorSpelling(c1));
+                ctx->fieldMeta->SetAnnotations(AnnotationsToVector(clang_getCursorSpelling(c1)));
                 break;
             }
             default:
@@ -249,28 +266,27 @@ CXChildVisitResult ReflectionParser::VisitMethod(CXCursor cursor, CXCursor paren
 {
     auto type = clang_getCursorType(cursor);
 
-    auto methodMeta = std::make_shared<MethodMeta>();
+    auto* methodMeta = parseState_->arena_.New<MethodMeta>(parseState_->arena_);
     owner->methods.push_back(methodMeta);
 
     {
-        methodMeta->name = toStdString(clang_getCursorSpelling(cursor));
-        methodMeta->type = toStdString(clang_getTypeSpelling(type));
-        methodMeta->namespace_ = parseState_.namespaceState.Current();
+        methodMeta->SetName(toInterned(clang_getCursorSpelling(cursor)), parseState_->namespaceState.Current(), parseState_->arena_);
+        methodMeta->type = toInterned(clang_getTypeSpelling(type));
         methodMeta->isStatic = isStatic;
 
         int numArgs = clang_Cursor_getNumArguments(cursor);
         for (int i = 0; i < numArgs; ++i) {
             auto argCursor = clang_Cursor_getArgument(cursor, i);
             NamedObject arg;
-            arg.name = toStdString(clang_getCursorSpelling(argCursor));
+            arg.name = toInterned(clang_getCursorSpelling(argCursor));
             if (arg.name.empty()) {
                 arg.name = "[unnamed]";
             }
             auto arg_type = clang_getArgType(type, i);
-            arg.type = toStdString(arg_type);
+            arg.type = toInterned(arg_type);
             methodMeta->arguments.push_back(arg);
         }
-        methodMeta->returnType = toStdString(clang_getResultType(type));
+        methodMeta->returnType = toInterned(clang_getResultType(type));
     }
 
     struct Context {
@@ -278,8 +294,8 @@ CXChildVisitResult ReflectionParser::VisitMethod(CXCursor cursor, CXCursor paren
         ParseState* state;
     };
     Context context {
-        methodMeta.get(),
-        &parseState_,
+        methodMeta,
+        parseState_.get(),
     };
     auto ret = clang_visitChildren(
         cursor, [](CXCursor c1, CXCursor p1, CXClientData d) {
@@ -290,7 +306,7 @@ CXChildVisitResult ReflectionParser::VisitMethod(CXCursor cursor, CXCursor paren
             switch (kind) {
             case CXCursor_AnnotateAttr: {
                 assert(ctx->methodMeta->annotations.empty());
-                ctx->methodMeta->annotations = AnnotationsToVector(toStdString(clang_getCursorSpelling(c1)));
+                ctx->methodMeta->SetAnnotations(AnnotationsToVector(clang_getCursorSpelling(c1)));
                 break;
             }
             default:
@@ -319,11 +335,11 @@ static bool IsUnsignedType(CXTypeKind kind)
 
 CXChildVisitResult ReflectionParser::VisitEnum(CXCursor cursor, CXCursor parent)
 {
-    auto name = GetClangCursorSpelling(cursor);
-    auto enumMeta = parseState_.GetOrCreateEnumMetaInCurrentNamespace(name);
+    auto name = GetClangCursorSpellingInterned(cursor);
+    auto* enumMeta = parseState_->GetOrCreateEnumMetaInCurrentNamespace(name);
     {
         enumMeta->isClass = clang_EnumDecl_isScoped(cursor);
-        enumMeta->underlyingType = toStdString(clang_getEnumDeclIntegerType(cursor));
+        enumMeta->underlyingType = toInterned(clang_getEnumDeclIntegerType(cursor));
     }
 
     struct Context {
@@ -332,7 +348,7 @@ CXChildVisitResult ReflectionParser::VisitEnum(CXCursor cursor, CXCursor parent)
     };
 
     Context ctx {
-        enumMeta.get(),
+        enumMeta,
         IsUnsignedType(clang_getEnumDeclIntegerType(cursor).kind),
     };
     clang_visitChildren(
@@ -344,12 +360,12 @@ CXChildVisitResult ReflectionParser::VisitEnum(CXCursor cursor, CXCursor parent)
             switch (kind) {
             case CXCursor_AnnotateAttr: {
                 assert(ctx->enumMeta->annotations.empty());
-                ctx->enumMeta->annotations = AnnotationsToVector(toStdString(clang_getCursorSpelling(c)));
+                ctx->enumMeta->SetAnnotations(AnnotationsToVector(clang_getCursorSpelling(c)));
                 break;
             }
             case CXCursor_EnumConstantDecl: {
                 ctx->enumMeta->values.push_back({
-                    GetClangCursorSpelling(c),
+                    GetClangCursorSpellingInterned(c),
                     ctx->isUnsigned ? std::to_string(clang_getEnumConstantDeclUnsignedValue(c))
                                     : std::to_string(clang_getEnumConstantDeclValue(c)),
                 });
@@ -33,9 +33,17 @@ public:
 
     int TraverseClasses(std::function<int(const ParseState&)> callback) const
     {
-        return callback(parseState_);
+        return callback(*parseState_);
     }
 
+    ParseState& GetParseState() { return *parseState_; }
+
+    // Keeps the result alive after the parser and its translation unit are gone, the parser can't be used afterwards
+    std::unique_ptr<ParseState> TakeParseState() { return std::move(parseState_); }
+
+    // The main file and all the files it includes, directly or indirectly
+    std::vector<std::string> GetIncludedFiles() const;
+
 private:
     CXChildVisitResult VisitNamespace(CXCursor c, CXCursor parent);
     CXChildVisitResult VisitClass(CXCursor c, CXCursor parent);
@@ -53,5 +61,5 @@ private:
     CXCursor rootCursor_ {};
 
     // parse state
-    ParseState parseState_ {};
+    std::unique_ptr<ParseState> parseState_ { std::make_unique<ParseState>() };
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "ScriptProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static const int kInstructionsPerCheck = 1000;
+static const auto kSamplePeriod = std::chrono::milliseconds(1);
+static const int kMaxDepth = 64;
+
+// The address is the key of the profiler in the registry
+static const char kRegistryKey = 0;
+
+ScriptProfiler::ScriptProfiler(lua_State* L)
+{
+    lua_pushlightuserdata(L, const_cast<char*>(&kRegistryKey));
+    lua_pushlightuserdata(L, this);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+    lua_sethook(L, Hook, LUA_MASKCOUNT, kInstructionsPerCheck);
+    lastCheck_ = std::chrono::steady_clock::now();
+}
+
+void ScriptProfiler::Start(const char* entry)
+{
+    entry_ = entry;
+    lastCheck_ = std::chrono::steady_clock::now();
+}
+
+void ScriptProfiler::Stop()
+{
+    // The tail of the callback, charged by a later sample
+    pending_ += std::chrono::steady_clock::now() - lastCheck_;
+}
+
+void ScriptProfiler::MergeInto(Stacks& stacks) const
+{
+    for (auto& [stack, micros] : stacks_) {
+        stacks[stack] += micros;
+    }
+}
+
+bool ScriptProfiler::Write(const std::string& path, const Stacks& stacks)
+{
+    std::vector<const Stacks::value_type*> sorted;
+    sorted.reserve(stacks.size());
+    for (auto& item : stacks) {
+        sorted.push_back(&item);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return a->first < b->first; });
+    std::ofstream ofs(path, std::ios::binary);
+    for (auto* item : sorted) {
+        ofs << item->first << ' ' << item->second << '\n';
+    }
+    if (!ofs) {
+        std::cerr << "Failed to write the script profile to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ScriptProfiler::Hook(lua_State* L, lua_Debug*)
+{
+    lua_pushlightuserdata(L, const_cast<char*>(&kRegistryKey));
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    auto* self = static_cast<ScriptProfiler*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    if (self != nullptr) {
+        self->Sample(L);
+    }
+}
+
+// "name (source:line)", ';' separates the frames so it can't be part of one
+static void AppendFrame(std::string& out, const lua_Debug& ar)
+{
+    auto begin = out.size();
+    if (ar.name != nullptr) {
+        out += ar.name;
+    } else if (ar.what != nullptr && std::string_view(ar.what) == "main") {
+        out += "main chunk";
+    } else {
+        out += '?';
+    }
+    if (ar.what != nullptr && std::string_view(ar.what) == "C") {
+        out += " [C]";
+    } else {
+        out += " (";
+        out += ar.short_src;
+        out += ':';
+        out += std::to_string(ar.linedefined);
+        out += ')';
+    }
+    std::replace(out.begin() + begin, out.end(), ';', ':');
+}
+
+void ScriptProfiler::Sample(lua_State* L)
+{
+    auto now = std::chrono::steady_clock::now();
+    pending_ += now - lastCheck_;
+    lastCheck_ = now;
+    if (pending_ < kSamplePeriod) {
+        return;
+    }
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(pending_).count();
+    pending_ = {};
+
+    lua_Debug levels[kMaxDepth];
+    int depth = 0;
+    while (depth < kMaxDepth && lua_getstack(L, depth, &levels[depth]) != 0) {
+        lua_getinfo(L, "Sn", &levels[depth]);
+        ++depth;
+    }
+    stack_ = entry_;
+    for (int i = depth - 1; i >= 0; --i) {
+        stack_ += ';';
+        AppendFrame(stack_, levels[i]);
+    }
+    stacks_[stack_] += uint64_t(micros);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <sol/sol.hpp>
+#include <string>
+#include <unordered_map>
+
+// A sampling profiler of the scripts of one Lua state. A count hook, cheap enough to leave on, checks the clock every
+// thousand instructions and adds the time since the previous check to the time pending. Once that passes a period, it's
+// charged to the current Lua stack. The time pending is kept from a callback to the next, so that callbacks shorter
+// than a period, or than a thousand instructions, are still sampled in proportion to their time. Time spent in C++
+// (the bindings, the templates, ...) is charged to the Lua function calling it.
+// Coroutines inherit the hook, their samples only have the frames of the coroutine, under the root of the callback.
+// The stacks are collapsed, i.e. "root;caller;callee", the format of flamegraph.pl.
+class ScriptProfiler {
+public:
+    // Collapsed stack -> microseconds
+    using Stacks = std::unordered_map<std::string, uint64_t>;
+
+    explicit ScriptProfiler(lua_State* L);
+    ScriptProfiler(const ScriptProfiler&) = delete;
+    ScriptProfiler& operator=(const ScriptProfiler&) = delete;
+
+    // Called right before the script is entered, entry is the root frame of the stacks until the next call, e.g. the
+    // name of the callback
+    void Start(const char* entry);
+    // Called once the script returns, the time out of the script, between Stop() and Start(), is not charged
+    void Stop();
+
+    void MergeInto(Stacks& stacks) const;
+
+    // Sorted by stack, so that the same profile gives the same file
+    static bool Write(const std::string& path, const Stacks& stacks);
+
+private:
+    static void Hook(lua_State* L, lua_Debug* ar);
+    void Sample(lua_State* L);
+
+    const char* entry_ { "" };
+    std::chrono::steady_clock::time_point lastCheck_ {};
+    std::chrono::steady_clock::duration pending_ {};
+    Stacks stacks_ {};
+    std::string stack_ {}; // reused by Sample()
+};
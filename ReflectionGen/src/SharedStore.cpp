@@ -0,0 +1,115 @@
+#include "SharedStore.h"
+#include <algorithm>
+
+int64_t SharedStore::Increment(std::string_view counter, int64_t delta)
+{
+    auto& shard = counters_.Get(Hash(counter));
+    {
+        std::shared_lock<std::shared_mutex> lck(shard.mutex);
+        auto it = shard.map.find(counter);
+        if (it != shard.map.end()) {
+            return it->second->fetch_add(delta) + delta;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lck(shard.mutex);
+    auto& value = shard.map[std::string(counter)];
+    if (value == nullptr) {
+        value = std::make_unique<std::atomic_int64_t>(0);
+    }
+    return value->fetch_add(delta) + delta;
+}
+
+int64_t SharedStore::GetCounter(std::string_view counter) const
+{
+    auto& shard = counters_.Get(Hash(counter));
+    std::shared_lock<std::shared_mutex> lck(shard.mutex);
+    auto it = shard.map.find(counter);
+    return it != shard.map.end() ? it->second->load() : 0;
+}
+
+size_t SharedStore::Append(std::string_view list, SharedValue value)
+{
+    auto& shard = lists_.Get(Hash(list));
+    List* target = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lck(shard.mutex);
+        auto it = shard.map.find(list);
+        if (it != shard.map.end()) {
+            target = it->second.get();
+        }
+    }
+    if (target == nullptr) {
+        std::unique_lock<std::shared_mutex> lck(shard.mutex);
+        auto& slot = shard.map[std::string(list)];
+        if (slot == nullptr) {
+            slot = std::make_unique<List>();
+        }
+        target = slot.get();
+    }
+    std::unique_lock<std::mutex> lck(target->mutex);
+    target->values.push_back(std::move(value));
+    return target->values.size();
+}
+
+std::vector<SharedValue> SharedStore::GetList(std::string_view list) const
+{
+    auto& shard = lists_.Get(Hash(list));
+    const List* target = nullptr;
+    {
+        std::shared_lock<std::shared_mutex> lck(shard.mutex);
+        auto it = shard.map.find(list);
+        if (it == shard.map.end()) {
+            return {};
+        }
+        target = it->second.get();
+    }
+    std::unique_lock<std::mutex> lck(target->mutex);
+    return target->values;
+}
+
+void SharedStore::Set(std::string_view map, std::string_view key, SharedValue value)
+{
+    auto& shard = maps_.Get(Hash(map) ^ Hash(key));
+    std::unique_lock<std::shared_mutex> lck(shard.mutex);
+    auto it = shard.map.find(map);
+    if (it == shard.map.end()) {
+        it = shard.map.emplace(std::string(map), StringMap<SharedValue> {}).first;
+    }
+    auto valueIt = it->second.find(key);
+    if (valueIt != it->second.end()) {
+        valueIt->second = std::move(value);
+    } else {
+        it->second.emplace(std::string(key), std::move(value));
+    }
+}
+
+std::optional<SharedValue> SharedStore::Get(std::string_view map, std::string_view key) const
+{
+    auto& shard = maps_.Get(Hash(map) ^ Hash(key));
+    std::shared_lock<std::shared_mutex> lck(shard.mutex);
+    auto it = shard.map.find(map);
+    if (it == shard.map.end()) {
+        return std::nullopt;
+    }
+    auto valueIt = it->second.find(key);
+    if (valueIt == it->second.end()) {
+        return std::nullopt;
+    }
+    return valueIt->second;
+}
+
+std::vector<std::pair<std::string, SharedValue>> SharedStore::GetMap(std::string_view map) const
+{
+    std::vector<std::pair<std::string, SharedValue>> entries;
+    for (auto& shard : maps_.shards) {
+        std::shared_lock<std::shared_mutex> lck(shard.mutex);
+        auto it = shard.map.find(map);
+        if (it != shard.map.end()) {
+            entries.insert(entries.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+    return entries;
+}
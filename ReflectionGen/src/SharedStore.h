@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using SharedValue = std::variant<int64_t, double, std::string>;
+
+// State shared by the scripts of all the work threads: counters, append-only lists and maps of strings/numbers,
+// each identified by name. Everything is split into shards by hash, the readers of a shard don't block each other,
+// and counters are plain atomics once created, so that unlike MiscUtils.DoExclusively the threads only wait for
+// each other when they touch the same entry.
+class SharedStore {
+public:
+    // Returns the new value, a counter starts from 0
+    int64_t Increment(std::string_view counter, int64_t delta);
+    int64_t GetCounter(std::string_view counter) const;
+
+    // Returns the new size of the list
+    size_t Append(std::string_view list, SharedValue value);
+    std::vector<SharedValue> GetList(std::string_view list) const;
+
+    void Set(std::string_view map, std::string_view key, SharedValue value);
+    std::optional<SharedValue> Get(std::string_view map, std::string_view key) const;
+    // Sorted by key, so that whatever generated from it doesn't depend on the thread order
+    std::vector<std::pair<std::string, SharedValue>> GetMap(std::string_view map) const;
+
+private:
+    static constexpr size_t kShardCount = 64;
+
+    template <typename Map>
+    struct Shards {
+        struct Shard {
+            mutable std::shared_mutex mutex {};
+            Map map {};
+        };
+        std::array<Shard, kShardCount> shards {};
+
+        Shard& Get(size_t hash) { return shards[(hash >> 7U) % kShardCount]; }
+        const Shard& Get(size_t hash) const { return shards[(hash >> 7U) % kShardCount]; }
+    };
+
+    struct List {
+        mutable std::mutex mutex {};
+        std::vector<SharedValue> values {};
+    };
+
+    struct TransparentHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view> {}(s); }
+    };
+
+    // Looked up by string_view without making a string
+    template <typename T>
+    using StringMap = std::unordered_map<std::string, T, TransparentHash, std::equal_to<>>;
+
+    static size_t Hash(std::string_view s) { return std::hash<std::string_view> {}(s); }
+
+private:
+    // The entries are never removed, so the atomics and lists can be used once the shard lock is released
+    Shards<StringMap<std::unique_ptr<std::atomic_int64_t>>> counters_ {};
+    Shards<StringMap<std::unique_ptr<List>>> lists_ {};
+    // Sharded by map name and key, a shard holds a part of many maps: map name -> key -> value
+    Shards<StringMap<StringMap<SharedValue>>> maps_ {};
+};
@@ -0,0 +1,190 @@
+#include "StringBuilder.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+template <typename T>
+static void AppendPrintf(std::string& out, const std::string& spec, T value)
+{
+    char buffer[128];
+    int size = std::snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+    if (size < 0) {
+        throw std::runtime_error("invalid conversion '" + spec + "' to 'Appendf'");
+    }
+    if (size_t(size) < sizeof(buffer)) {
+        out.append(buffer, size);
+        return;
+    }
+    auto offset = out.size();
+    out.resize(offset + size + 1);
+    std::snprintf(out.data() + offset, size + 1, spec.c_str(), value);
+    out.resize(offset + size);
+}
+
+// The same as lua_Number2str of Lua 5.4
+static void AppendLuaNumber(std::string& out, double value)
+{
+    char buffer[64];
+    int size = std::snprintf(buffer, sizeof(buffer), "%.14g", value);
+    out.append(buffer, size);
+    if (buffer[std::strspn(buffer, "-0123456789")] == '\0') {
+        out.append(".0");
+    }
+}
+
+static std::string ArgumentError(size_t index, const char* message)
+{
+    return "bad format argument #" + std::to_string(index) + " to 'Appendf' (" + message + ")";
+}
+
+static int64_t ToInteger(const FormatArgument& arg, size_t index)
+{
+    if (auto* integer = std::get_if<int64_t>(&arg)) {
+        return *integer;
+    }
+    if (auto* number = std::get_if<double>(&arg)) {
+        if (std::floor(*number) == *number && std::abs(*number) < 9.2e18) {
+            return int64_t(*number);
+        }
+        throw std::runtime_error(ArgumentError(index, "number has no integer representation"));
+    }
+    throw std::runtime_error(ArgumentError(index, "number expected, got string"));
+}
+
+static double ToDouble(const FormatArgument& arg, size_t index)
+{
+    if (auto* integer = std::get_if<int64_t>(&arg)) {
+        return double(*integer);
+    }
+    if (auto* number = std::get_if<double>(&arg)) {
+        return *number;
+    }
+    throw std::runtime_error(ArgumentError(index, "number expected, got string"));
+}
+
+StringBuilder& StringBuilder::Append(std::string_view text)
+{
+    while (!text.empty()) {
+        if (atLineStart_ && text.front() != '\n') {
+            for (int i = 0; i < indentLevel_; ++i) {
+                buffer_.append(indentUnit_);
+            }
+        }
+        auto newline = text.find('\n');
+        auto line = text.substr(0, newline == std::string_view::npos ? text.size() : newline + 1);
+        buffer_.append(line);
+        atLineStart_ = newline != std::string_view::npos;
+        text.remove_prefix(line.size());
+    }
+    return *this;
+}
+
+StringBuilder& StringBuilder::AppendInteger(int64_t value)
+{
+    char buffer[24];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return Append(std::string_view(buffer, end - buffer));
+}
+
+StringBuilder& StringBuilder::AppendNumber(double value)
+{
+    formatted_.clear();
+    AppendLuaNumber(formatted_, value);
+    return Append(formatted_);
+}
+
+StringBuilder& StringBuilder::AppendFormat(std::string_view format, const std::vector<FormatArgument>& args)
+{
+    formatted_.clear();
+    size_t argIndex = 0;
+    size_t i = 0;
+    while (i < format.size()) {
+        auto percent = format.find('%', i);
+        if (percent == std::string_view::npos) {
+            formatted_.append(format.substr(i));
+            break;
+        }
+        formatted_.append(format.substr(i, percent - i));
+        if (percent + 1 < format.size() && format[percent + 1] == '%') {
+            formatted_.push_back('%');
+            i = percent + 2;
+            continue;
+        }
+        auto end = format.find_first_not_of("-+ #0123456789.", percent + 1);
+        if (end == std::string_view::npos) {
+            throw std::runtime_error("invalid conversion '" + std::string(format.substr(percent)) + "' to 'Appendf'");
+        }
+        auto conversion = format[end];
+        std::string spec(format.substr(percent, end - percent));
+        i = end + 1;
+        if (argIndex >= args.size()) {
+            throw std::runtime_error(ArgumentError(argIndex + 1, "no value"));
+        }
+        auto& arg = args[argIndex++];
+        switch (conversion) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            spec += "ll";
+            spec += conversion;
+            AppendPrintf(formatted_, spec, (long long)ToInteger(arg, argIndex));
+            break;
+        case 'c':
+            spec += conversion;
+            AppendPrintf(formatted_, spec, int(ToInteger(arg, argIndex)));
+            break;
+        case 'a':
+        case 'A':
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+            spec += conversion;
+            AppendPrintf(formatted_, spec, ToDouble(arg, argIndex));
+            break;
+        case 's': {
+            std::string number;
+            std::string_view text;
+            if (auto* s = std::get_if<std::string_view>(&arg)) {
+                text = *s;
+            } else if (auto* integer = std::get_if<int64_t>(&arg)) {
+                number = std::to_string(*integer);
+                text = number;
+            } else {
+                AppendLuaNumber(number, std::get<double>(arg));
+                text = number;
+            }
+            if (spec == "%") {
+                formatted_.append(text);
+            } else {
+                spec += conversion;
+                AppendPrintf(formatted_, spec, std::string(text).c_str());
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("invalid conversion '" + spec + conversion + "' to 'Appendf'");
+        }
+    }
+    return Append(formatted_);
+}
+
+StringBuilder& StringBuilder::Indent(int delta)
+{
+    indentLevel_ = std::max(0, indentLevel_ + delta);
+    return *this;
+}
+
+StringBuilder& StringBuilder::SetIndentUnit(std::string_view unit)
+{
+    indentUnit_ = unit;
+    return *this;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+using FormatArgument = std::variant<int64_t, double, std::string_view>;
+
+// A growable output buffer for the scripts, appending to it doesn't create any Lua string, unlike `..`, which copies
+// the whole string built so far every time. Text appended at the start of a line is indented by the current level.
+class StringBuilder {
+public:
+    StringBuilder& Append(std::string_view text);
+    StringBuilder& AppendInteger(int64_t value);
+    // Like Lua's tostring(), e.g. 1.0 gives "1.0"
+    StringBuilder& AppendNumber(double value);
+    // printf-like, the conversions are those of Lua's string.format except %q, throws std::runtime_error on a bad
+    // format or argument
+    StringBuilder& AppendFormat(std::string_view format, const std::vector<FormatArgument>& args);
+
+    // Changes the indentation level by delta, it can't go below 0
+    StringBuilder& Indent(int delta);
+    StringBuilder& SetIndentUnit(std::string_view unit);
+
+    void Reserve(size_t size) { buffer_.reserve(size); }
+    void Clear()
+    {
+        buffer_.clear();
+        atLineStart_ = true;
+    }
+    size_t Size() const { return buffer_.size(); }
+    std::string_view View() const { return buffer_; }
+    const std::string& ToString() const { return buffer_; }
+
+private:
+    std::string buffer_ {};
+    std::string indentUnit_ { "    " };
+    int indentLevel_ { 0 };
+    bool atLineStart_ { true };
+    std::string formatted_ {}; // reused by AppendFormat
+};
@@ -1,7 +1,10 @@
 #pragma
+#include "Annotation.h"
+#include "InternedString.h"
 #include "StringUtils.h"
 #include <algorithm>
 #include <clang-c/Index.h>
+#include <iostream>
 #include <ostream>
 #include <string>
 
@@ -23,14 +26,27 @@ inline std::string toStdString(const CXType type)
     return toStdString(clang_getTypeSpelling(type));
 }
 
-inline std::vector<std::string> AnnotationsToVector(const std::string& annotations)
+// Intern straight from the CXString, no std::string is built if the string is already in the pool
+inline InternedString toInterned(const CXString& str)
 {
-    std::vector<std::string> vec = StringUtils::Split(annotations, ',');
-    for (auto& s : vec) {
-        StringUtils::Trim(s);
-    }
-    vec.erase(std::remove(vec.begin(), vec.end(), ""), vec.end());
+    InternedString s { std::string_view(clang_getCString(str)) };
+    clang_disposeString(str);
+    return s;
+}
 
+inline InternedString toInterned(const CXType type)
+{
+    return toInterned(clang_getTypeSpelling(type));
+}
+
+inline std::vector<InternedString> AnnotationsToVector(const CXString& annotations)
+{
+    std::vector<std::string_view> items;
+    if (!AnnotationParser::SplitItems(clang_getCString(annotations), items)) {
+        std::cerr << "Unterminated string in annotation '" << clang_getCString(annotations) << "'" << std::endl;
+    }
+    std::vector<InternedString> vec { items.begin(), items.end() };
+    clang_disposeString(annotations);
     return vec;
 }
 
@@ -38,11 +54,15 @@ inline std::string GetClangCursorSpelling(CXCursor c)
 {
     return toStdString(clang_getCursorSpelling(c));
 }
+inline InternedString GetClangCursorSpellingInterned(CXCursor c)
+{
+    return toInterned(clang_getCursorSpelling(c));
+}
 inline std::string GetClangCursorKindSpelling(CXCursor c)
 {
     return toStdString(clang_getCursorKindSpelling(clang_getCursorKind(c)));
 }
-inline std::string GetClangCursorTypeSpelling(CXCursor c)
+inline InternedString GetClangCursorTypeSpelling(CXCursor c)
 {
-    return toStdString(clang_getTypeSpelling(clang_getCursorType(c)));
+    return toInterned(clang_getTypeSpelling(clang_getCursorType(c)));
 }
\ No newline at end of file
@@ -183,4 +183,15 @@ public:
         TrimRight(str);
         TrimLeft(str);
     }
+
+    static std::string_view Trimmed(std::string_view str)
+    {
+        while (!str.empty() && isspace(str.back())) {
+            str.remove_suffix(1);
+        }
+        while (!str.empty() && isspace(str.front())) {
+            str.remove_prefix(1);
+        }
+        return str;
+    }
 };
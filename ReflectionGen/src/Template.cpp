@@ -0,0 +1,527 @@
+#include "Template.h"
+#include "StringUtils.h"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+using Op = Template::Op;
+using Property = Template::Property;
+
+const std::unordered_map<std::string_view, Property> kProperties {
+    { ".", Property::kCurrent },
+    { "-index", Property::kIndex },
+    { "-first", Property::kFirst },
+    { "-last", Property::kLast },
+    { "name", Property::kName },
+    { "type", Property::kType },
+    { "fullName", Property::kFullName },
+    { "annotations", Property::kAnnotations },
+    { "classes", Property::kClasses },
+    { "enums", Property::kEnums },
+    { "isAbstract", Property::kIsAbstract },
+    { "constructors", Property::kConstructors },
+    { "methods", Property::kMethods },
+    { "fields", Property::kFields },
+    { "returnType", Property::kReturnType },
+    { "isStatic", Property::kIsStatic },
+    { "arguments", Property::kArguments },
+    { "isClass", Property::kIsClass },
+    { "underlyingType", Property::kUnderlyingType },
+    { "values", Property::kValues },
+    { "value", Property::kValue },
+};
+
+enum class Kind : uint8_t {
+    kParseState,
+    kClass,
+    kEnum,
+    kConstructor,
+    kMethod,
+    kField,
+    kArgument,
+    kEnumValue,
+    kString,
+    kAnnotationValue,
+};
+
+// A list the template can loop over, `vector` is a std::vector of the element type of the kind
+struct List {
+    Kind kind;
+    const void* vector;
+    uint32_t count;
+};
+
+struct Value {
+    enum class Type : uint8_t {
+        kNone,
+        kBool,
+        kInteger,
+        kNumber,
+        kString,
+        kList,
+    };
+
+    Type type { Type::kNone };
+    bool boolean {};
+    int64_t integer {};
+    double number {};
+    std::string_view string {};
+    List list {};
+
+    static Value Bool(bool b) { return Value { .type = Type::kBool, .boolean = b }; }
+    static Value String(std::string_view s) { return Value { .type = Type::kString, .string = s }; }
+    template <typename T, typename Allocator>
+    static Value ListOf(Kind kind, const std::vector<T, Allocator>& v)
+    {
+        return Value { .type = Type::kList, .list = List { kind, &v, uint32_t(v.size()) } };
+    }
+
+    bool IsTruthy() const
+    {
+        switch (type) {
+        case Type::kNone:
+            return false;
+        case Type::kBool:
+            return boolean;
+        case Type::kString:
+            return !string.empty();
+        case Type::kList:
+            return list.count > 0;
+        default:
+            return true;
+        }
+    }
+};
+
+Value FromAnnotationValue(const AnnotationValue& value)
+{
+    switch (value.type) {
+    case AnnotationValue::Type::kBool:
+        return Value::Bool(value.boolean);
+    case AnnotationValue::Type::kInteger:
+        return Value { .type = Value::Type::kInteger, .integer = value.integer };
+    case AnnotationValue::Type::kNumber:
+        return Value { .type = Value::Type::kNumber, .number = value.number };
+    case AnnotationValue::Type::kString:
+        return Value::String(value.string);
+    case AnnotationValue::Type::kList:
+        return Value::ListOf(Kind::kAnnotationValue, value.list);
+    }
+    return {};
+}
+
+std::string LineError(std::string_view source, size_t offset, const std::string& message)
+{
+    auto line = std::count(source.begin(), source.begin() + offset, '\n') + 1;
+    return "Template line " + std::to_string(line) + ": " + message;
+}
+
+bool IsBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+} // namespace
+
+struct Template::Frame {
+    Kind kind;
+    const void* object;
+    uint32_t index; // in the list it's from, if count > 0
+    uint32_t count;
+};
+
+namespace {
+
+const void* ElementAt(const List& list, uint32_t i)
+{
+    switch (list.kind) {
+    case Kind::kClass:
+        return (*static_cast<const std::vector<ClassMeta*>*>(list.vector))[i];
+    case Kind::kEnum:
+        return (*static_cast<const std::vector<EnumMeta*>*>(list.vector))[i];
+    case Kind::kConstructor:
+        return (*static_cast<const ArenaVector<ConstructorMeta*>*>(list.vector))[i];
+    case Kind::kMethod:
+        return (*static_cast<const ArenaVector<MethodMeta*>*>(list.vector))[i];
+    case Kind::kField:
+        return (*static_cast<const ArenaVector<FieldMeta*>*>(list.vector))[i];
+    case Kind::kArgument:
+        return &(*static_cast<const ArenaVector<NamedObject>*>(list.vector))[i];
+    case Kind::kEnumValue:
+        return &(*static_cast<const ArenaVector<EnumValue>*>(list.vector))[i];
+    case Kind::kString:
+        return &(*static_cast<const ArenaVector<InternedString>*>(list.vector))[i];
+    case Kind::kAnnotationValue:
+        return &(*static_cast<const std::vector<AnnotationValue>*>(list.vector))[i];
+    case Kind::kParseState:
+        break;
+    }
+    return nullptr;
+}
+
+const BaseMeta* AsBaseMeta(const Template::Frame& frame)
+{
+    switch (frame.kind) {
+    case Kind::kClass:
+        return static_cast<const ClassMeta*>(frame.object);
+    case Kind::kEnum:
+        return static_cast<const EnumMeta*>(frame.object);
+    case Kind::kConstructor:
+        return static_cast<const ConstructorMeta*>(frame.object);
+    case Kind::kMethod:
+        return static_cast<const MethodMeta*>(frame.object);
+    case Kind::kField:
+        return static_cast<const FieldMeta*>(frame.object);
+    default:
+        return nullptr;
+    }
+}
+
+// The value of a property for one frame, kNone if the frame has no such property
+Value Lookup(const Template::Frame& frame, const Template::Instruction& ins)
+{
+    if (auto* meta = AsBaseMeta(frame)) {
+        switch (ins.property) {
+        case Property::kName:
+            return Value::String(meta->name);
+        case Property::kType:
+            return Value::String(meta->type);
+        case Property::kFullName:
+            return Value::String(meta->GetFullName());
+        case Property::kAnnotations:
+            return Value::ListOf(Kind::kString, meta->annotations);
+        case Property::kAnnotation: {
+            auto it = meta->annotationMap.find(ins.key);
+            return it != meta->annotationMap.end() ? FromAnnotationValue(it->second) : Value {};
+        }
+        default:
+            break;
+        }
+    }
+    switch (frame.kind) {
+    case Kind::kParseState: {
+        auto* state = static_cast<const ParseState*>(frame.object);
+        switch (ins.property) {
+        case Property::kClasses:
+            return Value::ListOf(Kind::kClass, state->classList_);
+        case Property::kEnums:
+            return Value::ListOf(Kind::kEnum, state->enumList_);
+        default:
+            return {};
+        }
+    }
+    case Kind::kClass: {
+        auto* classMeta = static_cast<const ClassMeta*>(frame.object);
+        switch (ins.property) {
+        case Property::kIsAbstract:
+            return Value::Bool(classMeta->isAbstract);
+        case Property::kConstructors:
+            return Value::ListOf(Kind::kConstructor, classMeta->constructors);
+        case Property::kMethods:
+            return Value::ListOf(Kind::kMethod, classMeta->methods);
+        case Property::kFields:
+            return Value::ListOf(Kind::kField, classMeta->fields);
+        default:
+            return {};
+        }
+    }
+    case Kind::kEnum: {
+        auto* enumMeta = static_cast<const EnumMeta*>(frame.object);
+        switch (ins.property) {
+        case Property::kIsClass:
+            return Value::Bool(enumMeta->isClass);
+        case Property::kUnderlyingType:
+            return Value::String(enumMeta->underlyingType);
+        case Property::kValues:
+            return Value::ListOf(Kind::kEnumValue, enumMeta->values);
+        default:
+            return {};
+        }
+    }
+    case Kind::kConstructor:
+        return ins.property == Property::kArguments ? Value::ListOf(Kind::kArgument, static_cast<const ConstructorMeta*>(frame.object)->arguments) : Value {};
+    case Kind::kMethod: {
+        auto* method = static_cast<const MethodMeta*>(frame.object);
+        switch (ins.property) {
+        case Property::kReturnType:
+            return Value::String(method->returnType);
+        case Property::kIsStatic:
+            return Value::Bool(method->isStatic);
+        case Property::kArguments:
+            return Value::ListOf(Kind::kArgument, method->arguments);
+        default:
+            return {};
+        }
+    }
+    case Kind::kField:
+        return ins.property == Property::kIsStatic ? Value::Bool(static_cast<const FieldMeta*>(frame.object)->isStatic) : Value {};
+    case Kind::kArgument: {
+        auto* argument = static_cast<const NamedObject*>(frame.object);
+        switch (ins.property) {
+        case Property::kName:
+            return Value::String(argument->name);
+        case Property::kType:
+            return Value::String(argument->type);
+        default:
+            return {};
+        }
+    }
+    case Kind::kEnumValue: {
+        auto* value = static_cast<const EnumValue*>(frame.object);
+        switch (ins.property) {
+        case Property::kName:
+            return Value::String(value->name);
+        case Property::kValue:
+            return Value::String(value->value);
+        default:
+            return {};
+        }
+    }
+    case Kind::kString:
+        return ins.property == Property::kCurrent ? Value::String(*static_cast<const InternedString*>(frame.object)) : Value {};
+    case Kind::kAnnotationValue:
+        return ins.property == Property::kCurrent ? FromAnnotationValue(*static_cast<const AnnotationValue*>(frame.object)) : Value {};
+    }
+    return {};
+}
+
+// Looks up the frames from the innermost one
+Value Resolve(const std::vector<Template::Frame>& frames, const Template::Instruction& ins)
+{
+    if (ins.property == Property::kIndex || ins.property == Property::kFirst || ins.property == Property::kLast) {
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+            if (it->count == 0) {
+                continue;
+            }
+            if (ins.property == Property::kIndex) {
+                return Value { .type = Value::Type::kInteger, .integer = int64_t(it->index) + 1 };
+            }
+            return Value::Bool(ins.property == Property::kFirst ? it->index == 0 : it->index + 1 == it->count);
+        }
+        return {};
+    }
+    for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        auto value = Lookup(*it, ins);
+        if (value.type != Value::Type::kNone) {
+            return value;
+        }
+    }
+    return {};
+}
+
+void Write(const Value& value, StringBuilder& sb)
+{
+    switch (value.type) {
+    case Value::Type::kBool:
+        sb.Append(value.boolean ? "true" : "false");
+        break;
+    case Value::Type::kInteger:
+        sb.AppendInteger(value.integer);
+        break;
+    case Value::Type::kNumber:
+        sb.AppendNumber(value.number);
+        break;
+    case Value::Type::kString:
+        sb.Append(value.string);
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
+Template::~Template() = default;
+
+std::shared_ptr<const Template> Template::Compile(std::string_view source)
+{
+    static std::mutex mutex {};
+    static std::unordered_map<std::string, std::shared_ptr<const Template>> compiled {};
+    {
+        std::unique_lock<std::mutex> lck(mutex);
+        auto it = compiled.find(std::string(source));
+        if (it != compiled.end()) {
+            return it->second;
+        }
+    }
+    std::shared_ptr<Template> tpl(new Template());
+    tpl->Parse(source);
+    std::unique_lock<std::mutex> lck(mutex);
+    return compiled.emplace(std::string(source), std::move(tpl)).first->second;
+}
+
+void Template::Parse(std::string_view source)
+{
+    std::string text;
+    std::vector<uint32_t> openSections;
+    auto flushText = [this, &text]() {
+        if (!text.empty()) {
+            instructions_.push_back(Instruction { .op = Op::kText, .text = std::move(text) });
+            text.clear();
+        }
+    };
+    size_t pos = 0;
+    while (pos < source.size()) {
+        auto open = source.find("{{", pos);
+        if (open == std::string_view::npos) {
+            text.append(source.substr(pos));
+            break;
+        }
+        text.append(source.substr(pos, open - pos));
+        auto close = source.find("}}", open + 2);
+        if (close == std::string_view::npos) {
+            throw std::runtime_error(LineError(source, open, "unclosed tag"));
+        }
+        auto tag = StringUtils::Trimmed(source.substr(open + 2, close - open - 2));
+        pos = close + 2;
+        char sigil = tag.empty() ? '\0' : tag.front();
+        bool isBlock = sigil == '#' || sigil == '^' || sigil == '/' || sigil == '!';
+
+        // A block tag alone on its line takes the whole line with it
+        if (isBlock) {
+            auto lineStart = open;
+            while (lineStart > 0 && IsBlank(source[lineStart - 1])) {
+                --lineStart;
+            }
+            auto lineEnd = pos;
+            while (lineEnd < source.size() && IsBlank(source[lineEnd])) {
+                ++lineEnd;
+            }
+            bool standalone = (lineStart == 0 || source[lineStart - 1] == '\n') && (lineEnd == source.size() || source[lineEnd] == '\n');
+            if (standalone) {
+                text.resize(text.size() - (open - lineStart));
+                pos = lineEnd == source.size() ? lineEnd : lineEnd + 1;
+            }
+        }
+        if (sigil == '!') {
+            continue;
+        }
+        flushText();
+
+        auto name = isBlock ? StringUtils::Trimmed(tag.substr(1)) : tag;
+        Instruction ins { .op = Op::kValue, .text = std::string(name) };
+        if (!name.empty() && name.front() == '@' && name.size() > 1) {
+            ins.property = Property::kAnnotation;
+            ins.key = name.substr(1);
+        } else if (auto it = kProperties.find(name); it != kProperties.end()) {
+            ins.property = it->second;
+        } else {
+            throw std::runtime_error(LineError(source, open, "unknown property '" + std::string(name) + "'"));
+        }
+
+        if (sigil == '#' || sigil == '^') {
+            ins.op = sigil == '#' ? Op::kSection : Op::kInvertedSection;
+            openSections.push_back(uint32_t(instructions_.size()));
+        } else if (sigil == '/') {
+            if (openSections.empty() || instructions_[openSections.back()].text != name) {
+                throw std::runtime_error(LineError(source, open, "unexpected end of section '" + std::string(name) + "'"));
+            }
+            ins.op = Op::kSectionEnd;
+            ins.jump = openSections.back();
+            instructions_[openSections.back()].jump = uint32_t(instructions_.size());
+            openSections.pop_back();
+        }
+        instructions_.push_back(std::move(ins));
+    }
+    flushText();
+    if (!openSections.empty()) {
+        throw std::runtime_error("Template: section '" + instructions_[openSections.back()].text + "' is not closed");
+    }
+}
+
+void Template::Render(const Frame& root, StringBuilder& sb) const
+{
+    struct OpenSection {
+        uint32_t begin;
+        List list;
+        uint32_t index;
+        bool isLoop;
+    };
+    std::vector<Frame> frames { root };
+    std::vector<OpenSection> openSections;
+    uint32_t pc = 0;
+    while (pc < instructions_.size()) {
+        auto& ins = instructions_[pc];
+        switch (ins.op) {
+        case Op::kText:
+            sb.Append(ins.text);
+            ++pc;
+            break;
+        case Op::kValue:
+            Write(Resolve(frames, ins), sb);
+            ++pc;
+            break;
+        case Op::kSection: {
+            auto value = Resolve(frames, ins);
+            if (!value.IsTruthy()) {
+                pc = ins.jump + 1;
+                break;
+            }
+            bool isLoop = value.type == Value::Type::kList;
+            if (isLoop) {
+                frames.push_back(Frame { value.list.kind, ElementAt(value.list, 0), 0, value.list.count });
+            }
+            openSections.push_back(OpenSection { pc, value.list, 0, isLoop });
+            ++pc;
+            break;
+        }
+        case Op::kInvertedSection:
+            if (Resolve(frames, ins).IsTruthy()) {
+                pc = ins.jump + 1;
+                break;
+            }
+            openSections.push_back(OpenSection { pc, {}, 0, false });
+            ++pc;
+            break;
+        case Op::kSectionEnd: {
+            auto& section = openSections.back();
+            if (section.isLoop && section.index + 1 < section.list.count) {
+                ++section.index;
+                frames.back() = Frame { section.list.kind, ElementAt(section.list, section.index), section.index, section.list.count };
+                pc = section.begin + 1;
+                break;
+            }
+            if (section.isLoop) {
+                frames.pop_back();
+            }
+            openSections.pop_back();
+            ++pc;
+            break;
+        }
+        }
+    }
+}
+
+void Template::Render(const ParseState& state, StringBuilder& sb) const
+{
+    Render(Frame { Kind::kParseState, &state, 0, 0 }, sb);
+}
+
+void Template::Render(const ClassMeta& meta, StringBuilder& sb) const
+{
+    Render(Frame { Kind::kClass, &meta, 0, 0 }, sb);
+}
+
+void Template::Render(const EnumMeta& meta, StringBuilder& sb) const
+{
+    Render(Frame { Kind::kEnum, &meta, 0, 0 }, sb);
+}
+
+void Template::Render(const ConstructorMeta& meta, StringBuilder& sb) const
+{
+    Render(Frame { Kind::kConstructor, &meta, 0, 0 }, sb);
+}
+
+void Template::Render(const MethodMeta& meta, StringBuilder& sb) const
+{
+    Render(Frame { Kind::kMethod, &meta, 0, 0 }, sb);
+}
+
+void Template::Render(const FieldMeta& meta, StringBuilder& sb) const
+{
+    Render(Frame { Kind::kField, &meta, 0, 0 }, sb);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Meta.h"
+#include "ParseState.h"
+#include "StringBuilder.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A mustache-like template rendered straight from the metas, without creating any Lua object:
+//   {{name}}                  a property of the current meta, or of the enclosing ones if it has no such property
+//   {{@Key}}                  the value of the annotation Key, e.g. `Category = "Physics"` gives Physics
+//   {{#fields}}..{{/fields}}  a loop over a list, or a conditional for a boolean, string or annotation
+//   {{^fields}}..{{/fields}}  rendered only if the list is empty, or the value false or missing
+//   {{-index}} {{-first}} {{-last}}  the 1 based index in the innermost loop, and whether it's the first/last item
+//   {{.}}                     the current item of a list of strings, e.g. annotations
+//   {{! comment }}
+// A line holding only a section tag or a comment is removed entirely. The properties are those of the usertypes:
+// name, type, fullName, annotations, classes, enums (of a ParseResult), isAbstract, constructors, methods, fields,
+// returnType, isStatic, arguments, isClass, underlyingType, values, value.
+class Template {
+public:
+    enum class Op : uint8_t {
+        kText,
+        kValue,
+        kSection,
+        kInvertedSection,
+        kSectionEnd,
+    };
+
+    // The names are resolved when compiling, rendering never compares strings
+    enum class Property : uint8_t {
+        kCurrent,
+        kAnnotation,
+        kIndex,
+        kFirst,
+        kLast,
+        kName,
+        kType,
+        kFullName,
+        kAnnotations,
+        kClasses,
+        kEnums,
+        kIsAbstract,
+        kConstructors,
+        kMethods,
+        kFields,
+        kReturnType,
+        kIsStatic,
+        kArguments,
+        kIsClass,
+        kUnderlyingType,
+        kValues,
+        kValue,
+    };
+
+    struct Instruction {
+        Op op { Op::kText };
+        Property property { Property::kCurrent };
+        uint32_t jump {};      // of a section: the index of its end, of an end: the index of its section
+        std::string text {};   // of a text: the text, of a section: its name, to match the end
+        InternedString key {}; // of an annotation
+    };
+
+    struct Frame;
+
+    // Compiled once per source text and shared by all the threads, throws std::runtime_error on a syntax error
+    static std::shared_ptr<const Template> Compile(std::string_view source);
+
+    Template(const Template&) = delete;
+    Template& operator=(const Template&) = delete;
+    ~Template();
+
+    void Render(const ParseState& state, StringBuilder& sb) const;
+    void Render(const ClassMeta& meta, StringBuilder& sb) const;
+    void Render(const EnumMeta& meta, StringBuilder& sb) const;
+    void Render(const ConstructorMeta& meta, StringBuilder& sb) const;
+    void Render(const MethodMeta& meta, StringBuilder& sb) const;
+    void Render(const FieldMeta& meta, StringBuilder& sb) const;
+
+private:
+    Template() = default;
+
+    void Parse(std::string_view source);
+    void Render(const Frame& root, StringBuilder& sb) const;
+
+private:
+    std::vector<Instruction> instructions_ {};
+};
@@ -0,0 +1,78 @@
+#include "TypeRegistry.h"
+#include <algorithm>
+#include <functional>
+
+TypeRegistry::Shard& TypeRegistry::GetShard(std::string_view fullName) const
+{
+    auto hash = std::hash<std::string_view> {}(fullName);
+    return shards_[(hash >> 7U) % kShardCount];
+}
+
+void TypeRegistry::Add(std::shared_ptr<TypeRecord> record)
+{
+    auto fullName = record->GetMeta().GetFullName();
+    auto& shard = GetShard(fullName);
+    std::unique_lock<std::mutex> lck(shard.mutex);
+    auto& slot = shard.records[std::string(fullName)];
+    if (slot == nullptr || (slot->IsEmpty() && !record->IsEmpty())) {
+        slot = std::move(record);
+    }
+}
+
+void TypeRegistry::Merge(const std::shared_ptr<ParseState>& state, const std::string& file)
+{
+    for (auto* classMeta : state->classList_) {
+        Add(std::make_shared<TypeRecord>(TypeRecord { state, classMeta, nullptr, file }));
+    }
+    for (auto* enumMeta : state->enumList_) {
+        Add(std::make_shared<TypeRecord>(TypeRecord { state, nullptr, enumMeta, file }));
+    }
+}
+
+std::shared_ptr<TypeRecord> TypeRegistry::Find(std::string_view fullName) const
+{
+    auto& shard = GetShard(fullName);
+    std::unique_lock<std::mutex> lck(shard.mutex);
+    auto it = shard.records.find(std::string(fullName));
+    return it != shard.records.end() ? it->second : nullptr;
+}
+
+size_t TypeRegistry::Size() const
+{
+    size_t size = 0;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::mutex> lck(shard.mutex);
+        size += shard.records.size();
+    }
+    return size;
+}
+
+std::vector<std::shared_ptr<TypeRecord>> TypeRegistry::GetAll() const
+{
+    std::vector<std::shared_ptr<TypeRecord>> records;
+    for (auto& shard : shards_) {
+        std::unique_lock<std::mutex> lck(shard.mutex);
+        for (auto& [fullName, record] : shard.records) {
+            records.push_back(record);
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+        return a->GetMeta().GetFullName() < b->GetMeta().GetFullName();
+    });
+    return records;
+}
+
+void TypeRegistry::CollectAll(ParseState& state) const
+{
+    for (auto& record : GetAll()) {
+        // The key points to the full name in the record's arena
+        auto fullName = record->GetMeta().GetFullName();
+        if (record->classMeta != nullptr) {
+            state.classes_[fullName] = record->classMeta;
+            state.classList_.push_back(record->classMeta);
+        } else {
+            state.enums_[fullName] = record->enumMeta;
+            state.enumList_.push_back(record->enumMeta);
+        }
+    }
+}
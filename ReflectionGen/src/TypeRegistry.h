@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Meta.h"
+#include "ParseState.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A class/enum as seen by the whole program. It refers to the meta of the file it was parsed from, with all its members,
+// constructors and arguments included, and keeps the ParseState owning it alive. The metas aren't changed once
+// registered, so that they can be read from any work thread.
+struct TypeRecord {
+    std::shared_ptr<ParseState> source {};
+    ClassMeta* classMeta { nullptr }; // exactly one of them is set
+    EnumMeta* enumMeta { nullptr };
+    std::string file {}; // the input file it was parsed from
+
+    const BaseMeta& GetMeta() const { return classMeta != nullptr ? static_cast<const BaseMeta&>(*classMeta) : *enumMeta; }
+
+    // Nothing but the name, e.g. a forward declaration
+    bool IsEmpty() const { return classMeta != nullptr ? ParseState::IsEmpty(*classMeta) : ParseState::IsEmpty(*enumMeta); }
+};
+
+// Types of all the files processed so far, keyed by full name. It's only built when needed, i.e. when the scripts
+// enable it or something is called with the whole program. Every work thread merges its file into it once parsed,
+// the map is split into shards by hash, each with its own lock, so that the workers rarely wait for each other.
+class TypeRegistry {
+public:
+    // Merge all the classes and enums of a parsed file, a type already registered is only replaced if it was
+    // empty, i.e. a forward declaration doesn't hide the definition parsed in another file. The state mustn't be
+    // changed afterwards
+    void Merge(const std::shared_ptr<ParseState>& state, const std::string& file);
+
+    // Whether the scripts can use it, set before any file is merged
+    void Enable() { enabled_ = true; }
+    bool IsEnabled() const { return enabled_; }
+
+    std::shared_ptr<TypeRecord> Find(std::string_view fullName) const;
+
+    size_t Size() const;
+
+    // Sorted by full name, so that whatever generated from it doesn't depend on the parse order
+    std::vector<std::shared_ptr<TypeRecord>> GetAll() const;
+
+    // The whole program as one ParseState, sorted by full name. It refers to the metas of the records, which have to
+    // outlive it
+    void CollectAll(ParseState& state) const;
+
+private:
+    struct Shard {
+        mutable std::mutex mutex {};
+        std::unordered_map<std::string, std::shared_ptr<TypeRecord>> records {};
+    };
+
+    static constexpr size_t kShardCount = 64;
+
+    Shard& GetShard(std::string_view fullName) const;
+
+    void Add(std::shared_ptr<TypeRecord> record);
+
+private:
+    mutable std::array<Shard, kShardCount> shards_ {};
+    std::atomic_bool enabled_ { false };
+};
@@ -38,6 +38,13 @@ int main(int argc, char** argv)
     std::string outputDir;
     std::string relativeDir { "./" };
     uint32_t workThreadsCount = std::max(std::thread::hardware_concurrency() / 2, 1U);
+    std::string cacheDir;
+    uint64_t cacheMaxSizeMB { 0 };
+    bool cacheStats { false };
+    bool gcStats { false };
+    std::string profileScript;
+    std::vector<std::string> plugins;
+    uint32_t writeThreadsCount { 4 };
     bool debug { false };
     app.add_option("-s,--script", scriptFile, "The script used to process the parse result")
         ->required()
@@ -57,6 +64,19 @@ int main(int argc, char** argv)
     app.add_option("-r,--relative", relativeDir, "A directory to used get a relative path for input file, "
                                                  "so that we known where to put the generated file");
     app.add_option("-j,--jobs", workThreadsCount, "Concurrent parsing.");
+    app.add_option("--write-threads", writeThreadsCount, "Threads writing the generated files, so that the parsing threads "
+                                                         "don't wait for the file system, 4 by default. 0 writes them synchronously");
+    app.add_option("--cache-dir", cacheDir, "A directory to keep the incremental build state, "
+                                            "files not changed since the last run (including the files they include) will be skipped. "
+                                            "It can be shared by concurrent invocations, which then share the parse results");
+    app.add_option("--cache-max-size", cacheMaxSizeMB, "The size limit of the cache directory in MB, "
+                                                       "the least recently used entries are evicted beyond it. 0 means unlimited");
+    app.add_flag("--cache-stats", cacheStats, "Print out cache hit/miss statistics");
+    app.add_flag("--gc-stats", gcStats, "Print out Lua allocation and garbage collection statistics");
+    app.add_option("--profile-script", profileScript, "Sample where the scripts spend their time, and write the stacks to "
+                                                      "the given file, in the collapsed format of flamegraph.pl");
+    app.add_option("--plugin", plugins, "Shared library of a native generator, called along with the script. Can be "
+                                        "given more than once");
     app.add_flag("--debug", debug, "Print out debug message");
 
     CLI11_PARSE(app, argc, argv);
@@ -100,8 +120,15 @@ int main(int argc, char** argv)
         .outputDir = std::move(outputDir),
         .relativeDir = std::move(relativeDir),
         .workThreadsCount = workThreadsCount,
+        .writeThreadsCount = writeThreadsCount,
         .clangParams = std::move(clangParams),
         .scriptParams = std::move(scriptParams),
+        .cacheDir = std::move(cacheDir),
+        .cacheMaxSize = cacheMaxSizeMB * 1024 * 1024,
+        .cacheStats = cacheStats,
+        .gcStats = gcStats,
+        .profileScript = std::move(profileScript),
+        .plugins = std::move(plugins),
         .debug = debug,
     };
     ReflectionGen gen { std::move(config) };
@@ -0,0 +1,100 @@
+# Runs ReflectionGen on a class annotated with each part of the annotation grammar, the script checks the annotationMap:
+#  - string escapes, commas and '=' inside strings,
+#  - integers (from_chars, so no hex nor thousands separators), doubles parsed in the classic locale,
+#  - nested lists, bare text and booleans,
+#  - the first item with a given key wins, missing keys are nil.
+#   cmake -DREFLECTION_GEN=<exe> -DTEST_DATA=<dir> -DWORK_DIR=<dir> -P AnnotationTest.cmake
+
+file(REMOVE_RECURSE ${WORK_DIR})
+
+file(WRITE ${WORK_DIR}/annotations.hpp [=[
+class P_CLASS(Flag,
+    Escaped = "a\"b\\c\nd\te", Text = "x, y = z", Empty = "",
+    Int = 42, Negative = -7, Plus = +3, Large = 9007199254740993, Hex = 0x10,
+    Double = 2.5, NegativeDouble = -0.25, Leading = .5, Exponent = +1e3, Comma = "1,5",
+    List = (A, "b c", [1, {2.5, true}]), EmptyList = [],
+    Bare = Foo::Bar, On = true, Off = false,
+    First = 1, First = 2, Flag = 3) Annotated {
+};
+]=])
+
+file(WRITE ${WORK_DIR}/AnnotationTest.lua "dofile('${TEST_DATA}/Script.lua')\n")
+file(APPEND ${WORK_DIR}/AnnotationTest.lua [=[
+local function Check(name, actual, expected)
+    if actual ~= expected then
+        error(string.format("%s: expected %s (%s), got %s (%s)", name, tostring(expected), type(expected), tostring(actual), type(actual)))
+    end
+end
+
+local function IsInteger(value)
+    return math.type == nil or math.type(value) == "integer"
+end
+
+ReflectionGenCallback.OnFileParsed = function(result, task)
+    local m = result.classes["::Annotated"].annotationMap
+
+    Check("Flag", m.Flag, true)
+    Check("Escaped", m.Escaped, "a\"b\\c\nd\te")
+    Check("Text", m.Text, "x, y = z")
+    Check("Empty", m.Empty, "")
+
+    Check("Int", m.Int, 42)
+    Check("Int is an integer", IsInteger(m.Int), true)
+    Check("Negative", m.Negative, -7)
+    Check("Plus", m.Plus, 3)
+    if math.type ~= nil then
+        Check("Large", m.Large, 9007199254740993)
+    end
+    Check("Hex", m.Hex, "0x10")
+
+    Check("Double", m.Double, 2.5)
+    Check("NegativeDouble", m.NegativeDouble, -0.25)
+    Check("Leading", m.Leading, 0.5)
+    Check("Exponent", m.Exponent, 1000)
+    Check("Exponent is a float", math.type == nil or math.type(m.Exponent) == "float", true)
+    Check("Comma", m.Comma, "1,5")
+
+    Check("List size", #m.List, 3)
+    Check("List[1]", m.List[1], "A")
+    Check("List[2]", m.List[2], "b c")
+    Check("List[3] size", #m.List[3], 2)
+    Check("List[3][1]", m.List[3][1], 1)
+    Check("List[3][2] size", #m.List[3][2], 2)
+    Check("List[3][2][1]", m.List[3][2][1], 2.5)
+    Check("List[3][2][2]", m.List[3][2][2], true)
+    Check("List is cached", m.List, result.classes["::Annotated"].annotationMap.List)
+    Check("EmptyList", #m.EmptyList, 0)
+
+    Check("Bare", m.Bare, "Foo::Bar")
+    Check("On", m.On, true)
+    Check("Off", m.Off, false)
+
+    Check("First", m.First, 1)
+    Check("Missing", m.Missing, nil)
+    Check("Number key", m[1], nil)
+
+    local count = 0
+    for key, value in pairs(m) do
+        count = count + 1
+        Check("pairs " .. key, value, m[key])
+    end
+    -- The keys above once each, and the 'reflected' flag of the P_CLASS macro
+    Check("pairs count", count, 21)
+
+    FileUtils.WriteFile(task.outputFile .. '.ok', 'ok')
+end
+]=])
+
+execute_process(
+    COMMAND ${REFLECTION_GEN} -s ${WORK_DIR}/AnnotationTest.lua -f annotations.hpp -r . -o ${WORK_DIR}/out -j 1
+    WORKING_DIRECTORY ${WORK_DIR}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE output)
+if (NOT result EQUAL 0 OR output MATCHES "Failed")
+    message(FATAL_ERROR "ReflectionGen failed (${result}):\n${output}")
+endif()
+file(GLOB_RECURSE outputs ${WORK_DIR}/out/*.ok)
+if (NOT outputs)
+    message(FATAL_ERROR "The annotations weren't checked:\n${output}")
+endif()
@@ -0,0 +1,57 @@
+-- Measures the time spent in the script for a generator which touches every member several times, e.g.
+--   ./ReflectionGen -s Benchmark.lua -f big.hpp -j1
+--   REFLECTION_GEN_PLAIN_TABLES=1 ./ReflectionGen -s Benchmark.lua -f big.hpp -j1
+-- to compare the usertypes with the plain tables (ReflectionGenConfig.PlainTables).
+
+local kPasses = 5
+
+ReflectionGenConfig = {
+    PlainTables = os.getenv("REFLECTION_GEN_PLAIN_TABLES") == "1",
+    CompilerOptions = {
+        "-std=c++17",
+        "-x", "c++",
+        "-Wno-pragma-once-outside-header",
+        "-DP_PROPERTY(...)=__attribute__((annotate(\"reflected,\" #__VA_ARGS__)))",
+        "-DP_METHOD(...)=__attribute__((annotate(\"reflected,\" #__VA_ARGS__)))",
+        "-DP_CLASS(...)=__attribute__((annotate(\"reflected,\" #__VA_ARGS__)))",
+        "-DP_ENUM(...)=__attribute__((annotate(\"reflected,\" #__VA_ARGS__)))",
+    }
+}
+
+local function Generate(parseResult)
+    local parts = {}
+    for _, clazz in ipairs(parseResult.classList) do
+        local fullName = clazz:GetFullName()
+        for _, field in ipairs(clazz.fields) do
+            parts[#parts + 1] = fullName .. "::" .. field.name .. " " .. field.type .. " " .. #field.annotations
+        end
+        for _, method in ipairs(clazz.methods) do
+            local s = method.returnType .. " " .. method.name .. "("
+            for _, arg in ipairs(method.arguments) do
+                s = s .. arg.type .. " " .. arg.name .. ","
+            end
+            parts[#parts + 1] = s .. ")"
+        end
+        for _, ctor in ipairs(clazz.constructors) do
+            parts[#parts + 1] = fullName .. "(" .. #ctor.arguments .. ")"
+        end
+    end
+    for _, e in ipairs(parseResult.enumList) do
+        for _, value in ipairs(e.values) do
+            parts[#parts + 1] = e.name .. "::" .. value.name .. " = " .. value.value
+        end
+    end
+    return #parts
+end
+
+ReflectionGenCallback = {
+    OnFileParsed = function(parseResult, parseTask)
+        local start = os.clock()
+        local count = 0
+        for _ = 1, kPasses do
+            count = count + Generate(parseResult)
+        end
+        print(string.format("%s: %d lines in %.3f s (PlainTables = %s)", parseTask.inputFile, count,
+            os.clock() - start, tostring(ReflectionGenConfig.PlainTables)))
+    end,
+}
@@ -0,0 +1,53 @@
+# Runs ReflectionGen with a cache directory on header.hpp, which includes a standard header:
+#  - the second run must find the file up to date,
+#  - once the output directory is removed, the file must be generated again,
+#  - once a module required by the script changes, the file must be generated again.
+#   cmake -DREFLECTION_GEN=<exe> -DTEST_DATA=<dir> -DWORK_DIR=<dir> -P CacheTest.cmake
+
+file(REMOVE_RECURSE ${WORK_DIR})
+
+# Script.lua with a callback writing an output, whose content comes from a module
+file(WRITE ${WORK_DIR}/CacheTestBanner.lua "return '// version 1\\n'\n")
+file(WRITE ${WORK_DIR}/CacheTest.lua "
+package.path = '${WORK_DIR}/?.lua;' .. package.path
+local banner = require('CacheTestBanner')
+dofile('Script.lua')
+ReflectionGenCallback.OnFileParsed = function(result, task)
+    FileUtils.WriteFile(task.outputFile .. '.gen.h', banner)
+end
+")
+
+function(run_reflection_gen name expected)
+    execute_process(
+        COMMAND ${REFLECTION_GEN} -s ${WORK_DIR}/CacheTest.lua -f header.hpp -r . -o ${WORK_DIR}/out --cache-dir ${WORK_DIR}/cache --cache-stats -j 1
+        WORKING_DIRECTORY ${TEST_DATA}
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "Run '${name}' failed (${result}):\n${output}")
+    endif()
+    if (NOT output MATCHES "Cache: ${expected} up to date")
+        message(FATAL_ERROR "Run '${name}': expected ${expected} file up to date:\n${output}")
+    endif()
+    file(GLOB_RECURSE outputs ${WORK_DIR}/out/*.gen.h)
+    if (NOT outputs)
+        message(FATAL_ERROR "Run '${name}': no output generated:\n${output}")
+    endif()
+endfunction()
+
+run_reflection_gen("first" 0)
+run_reflection_gen("second" 1)
+
+file(REMOVE_RECURSE ${WORK_DIR}/out)
+run_reflection_gen("output removed" 0)
+run_reflection_gen("output restored" 1)
+
+file(WRITE ${WORK_DIR}/CacheTestBanner.lua "return '// version 2\\n'\n")
+run_reflection_gen("module changed" 0)
+file(GLOB_RECURSE outputs ${WORK_DIR}/out/*.gen.h)
+file(READ "${outputs}" content)
+if (NOT content MATCHES "version 2")
+    message(FATAL_ERROR "The output wasn't generated with the changed module:\n${content}")
+endif()
+run_reflection_gen("module unchanged" 1)
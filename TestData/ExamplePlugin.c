@@ -0,0 +1,119 @@
+// A native generator writing, next to each output file, a '.fields.txt' listing the fields of its annotated classes.
+//   cc -O2 -shared -fPIC -I ReflectionGen/include TestData/ExamplePlugin.c -o ExamplePlugin.so
+//   ./ReflectionGen -s Script.lua -f header.hpp -o out --plugin ./ExamplePlugin.so
+
+#include "ReflectionGenPlugin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Context {
+    const RgHost* host;
+    char* data;
+    size_t size;
+    size_t capacity;
+    size_t classCount;
+} Context;
+
+static void Append(Context* ctx, const char* data, size_t size)
+{
+    if (ctx->size + size > ctx->capacity) {
+        size_t capacity = ctx->capacity * 2 > ctx->size + size ? ctx->capacity * 2 : ctx->size + size + 256;
+        char* grown = (char*)realloc(ctx->data, capacity);
+        if (grown == NULL) {
+            return;
+        }
+        ctx->data = grown;
+        ctx->capacity = capacity;
+    }
+    memcpy(ctx->data + ctx->size, data, size);
+    ctx->size += size;
+}
+
+static void AppendString(Context* ctx, RgString s)
+{
+    Append(ctx, s.data, s.size);
+}
+
+static void AppendText(Context* ctx, const char* text)
+{
+    Append(ctx, text, strlen(text));
+}
+
+static int CreateContext(const RgHost* host, void** context)
+{
+    Context* ctx = (Context*)calloc(1, sizeof(Context));
+    if (ctx == NULL) {
+        return 1;
+    }
+    ctx->host = host;
+    *context = ctx;
+    return 0;
+}
+
+static void DestroyContext(void* context)
+{
+    Context* ctx = (Context*)context;
+    free(ctx->data);
+    free(ctx);
+}
+
+static int OnFileParsed(void* context, const RgTables* tables, const RgTask* task)
+{
+    Context* ctx = (Context*)context;
+    ctx->size = 0;
+    for (uint32_t c = 0; c < tables->classCount; ++c) {
+        const RgClass* clazz = &tables->classes[c];
+        if (clazz->annotationCount == 0) {
+            continue;
+        }
+        ++ctx->classCount;
+        AppendString(ctx, clazz->fullName);
+        AppendText(ctx, "\n");
+        for (uint32_t f = clazz->firstField; f < clazz->firstField + clazz->fieldCount; ++f) {
+            const RgField* field = &tables->fields[f];
+            AppendText(ctx, "    ");
+            AppendString(ctx, field->type);
+            AppendText(ctx, " ");
+            AppendString(ctx, field->name);
+            for (uint32_t a = field->firstAnnotation; a < field->firstAnnotation + field->annotationCount; ++a) {
+                AppendText(ctx, a == field->firstAnnotation ? " // " : ", ");
+                AppendString(ctx, tables->annotations[a]);
+            }
+            AppendText(ctx, "\n");
+        }
+    }
+    if (ctx->size == 0) {
+        return 0;
+    }
+
+    char path[4096];
+    int length = snprintf(path, sizeof(path), "%.*s.fields.txt", (int)task->outputFile.size, task->outputFile.data);
+    if (length < 0 || (size_t)length >= sizeof(path)) {
+        return 1;
+    }
+    if (ctx->host->MakeDirsForFile(path) != 0) {
+        return 1;
+    }
+    return ctx->host->WriteFile(path, ctx->data, ctx->size);
+}
+
+static int OnAllFilesParsed(void* context, const RgTables* tables)
+{
+    (void)context;
+    printf("ExamplePlugin: %u classes and %u enums in total\n", tables->classCount, tables->enumCount);
+    return 0;
+}
+
+static const RgPlugin kPlugin = {
+    RG_PLUGIN_API_VERSION,
+    CreateContext,
+    DestroyContext,
+    OnFileParsed,
+    OnAllFilesParsed,
+};
+
+RG_PLUGIN_EXPORT const RgPlugin* ReflectionGenGetPlugin(uint32_t hostApiVersion)
+{
+    return hostApiVersion == RG_PLUGIN_API_VERSION ? &kPlugin : NULL;
+}
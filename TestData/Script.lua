@@ -1,5 +1,7 @@
 
 local Config = {
+    -- GenerateCode only cares about annotated entities, so let ReflectionGen skip the files without any
+    SkipFilesWithoutAnnotations = true,
     CompilerOptions = {
         "-std=c++17",
         "-x", "c++",
@@ -11,32 +13,29 @@ local Config = {
     }
 }
 
+-- StringBuilder appends in place, instead of copying the whole string on every `..`
+local StringBuilder = ReflectionGen.StringBuilder
+
 local function GetFunctionParameterDeclare(argList)
-    local s = ''
-    local isFirst = true
-    for argIndex, arg in pairs(argList) do
-        if isFirst then
-            isFirst = false
-        else
-            s = s .. ', '
+    local sb = StringBuilder.new()
+    for argIndex, arg in ipairs(argList) do
+        if argIndex > 1 then
+            sb:Append(', ')
         end
-        s = s .. arg.type .. ' ' .. arg.name
+        sb:Append(arg.type, ' ', arg.name)
     end
-    return s
+    return sb:ToString()
 end
 
 local function GetFunctionArgumentsList(argList)
-    local s = ''
-    local isFirst = true
-    for argIndex, arg in pairs(argList) do
-        if isFirst then
-            isFirst = false
-        else
-            s = s .. ', '
+    local sb = StringBuilder.new()
+    for argIndex, arg in ipairs(argList) do
+        if argIndex > 1 then
+            sb:Append(', ')
         end
-        s = s .. arg.name
+        sb:Append(arg.name)
     end
-    return s
+    return sb:ToString()
 end
 
 local function GetFunctionSignature(retType, name, argList)
@@ -68,6 +67,10 @@ local function PrintClass(clazz)
         print("\tType: " .. field.type)
         print("\tIsStatic: " .. tostring(field.isStatic))
         print("\tAnnotations: " .. table.concat(field.annotations, ", "))
+        -- The parsed annotations, e.g. Category = "hello" gives annotationMap.Category == "hello"
+        if field.annotationMap.Category ~= nil then
+            print("\tCategory: " .. field.annotationMap.Category)
+        end
     end
     for index, method in ipairs(clazz.methods) do
         print("--- method -----")
@@ -109,16 +112,16 @@ local Generator = {
 
 local function GenerateCodeForClass(clazz)
     local fullName = clazz:GetFullName():gsub('::', '_')
-    local code = string.format([[
-class %s_Operator {
-public:
-]], fullName)
+    local code = StringBuilder.new():SetIndentUnit('\t')
+    code:Appendf("class %s_Operator {\npublic:\n", fullName)
 
+    code:Indent(1)
     for index, ctor in ipairs(clazz.constructors) do
-        code = code .. '\t' .. Generator.GenerateCreator(ctor) .. '\n'
+        code:Append(Generator.GenerateCreator(ctor), '\n')
     end
+    code:Indent(-1)
 
-    code = code .. "\n};\n"
+    code:Append("\n};\n")
 
     print(code)
 --     for index, field in ipairs(clazz.fields) do
@@ -143,27 +146,36 @@ end
 
 local function GenerateCode(parseResult, parseTask)
     print(parseTask.inputFile, parseTask.outputFile)
-    local classes = parseResult.classes
-    local enums = parseResult.enums
-    for fullName, clazz in pairs(classes) do
-        print("ClassID " .. MiscUtils.NextClassId())
+    -- classList/enumList are in source order, unlike classes/enums which are iterated in hash order
+    local classes = parseResult.classList
+    local enums = parseResult.enumList
+    for _, clazz in ipairs(classes) do
+        print("ClassID " .. MiscUtils.ClassId(clazz:GetFullName()))
         if not clazz.annotations:empty() then
             PrintClass(clazz)
         end
     end
-    for fullName, e in pairs(enums) do
+    for _, e in ipairs(enums) do
         if not e.annotations:empty() then
             PrintEnum(e)
         end
     end
-    for fullName, clazz in pairs(classes) do
-        if not clazz.annotations:empty() then
-            GenerateCodeForClass(clazz)
-        end
+    -- Find returns the entities with the given annotation key, without scanning all of them
+    for _, clazz in ipairs(parseResult:Find("reflected").classes) do
+        GenerateCodeForClass(clazz)
+    end
+end
+
+-- Called once after all the files, with the classes/enums of all of them merged, sorted by full name
+local function GenerateRegistration(mergedResult)
+    print("// Registration of all the reflected classes")
+    for _, clazz in ipairs(mergedResult:Find("reflected").classes) do
+        print("REGISTER_CLASS(" .. clazz:GetFullName() .. ")")
     end
 end
 
 ReflectionGenConfig = Config
 ReflectionGenCallback = {
     OnFileParsed = GenerateCode,
+    OnAllFilesParsed = GenerateRegistration,
 }
\ No newline at end of file